@@ -13,8 +13,20 @@
 #include <iostream>
 #include <random>
 #include <ctime>
+#include <cstdint>
+#include <type_traits>
+#include <mutex>
+#include <deque>
+#include <span>
+#include <exception>
+#include <stdexcept>
 #include "nodes.h"
 #include "cfr_tree_nodes.h"
+#include "cfr_thread_pool.h"
+#include "cfr_node_arena.h"
+#include "cfr_kernels.h"
+#include "cfr_policy.h"
+#include "cfr_walk_stack.h"
 
 
 using Byte = unsigned char;
@@ -25,9 +37,9 @@ using Byte = unsigned char;
 template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
 concept GenericCfrRequirements =
 	CfrConcepts::PlayerNodePlayerOneFunc<PlayerNode>&&
-	CfrConcepts::PlayerNodeActionListFunc<Action, PlayerNode, GameClass>&&
+	CfrConcepts::PlayerNodeActionsFunc<Action, PlayerNode, GameClass>&&
 	CfrConcepts::PlayerNodeChildFunc<Action, PlayerNode, ChanceNode, GameClass>&&
-	CfrConcepts::ChanceNodeChildrenFunc<Action, PlayerNode, ChanceNode, GameClass>&&
+	CfrConcepts::ChanceNodeChildListFunc<Action, PlayerNode, ChanceNode, GameClass>&&
 	CfrConcepts::NeedsUtilityFunc< Action, PlayerNode, ChanceNode, GameClass>&&
 	CfrConcepts::Hashable< Action, PlayerNode, ChanceNode>;
 
@@ -39,8 +51,11 @@ concept GenericCfrRequirements =
 
 
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
+template<
+	typename Action, typename PlayerNode, typename ChanceNode, typename GameClass,
+	typename Policy = DefaultCfrPolicy
+>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
 class CfrTree {
 
 	/**
@@ -69,44 +84,370 @@ class CfrTree {
 	long long search_tree_size_;
 	long long info_set_table_size_;
 
+	/**
+	 * @brief Number of nodes in the search tree.
+	 */
+	long long num_nodes_;
+
+	/**
+	 * @brief Index over the search tree walked by CFR and MCCFR in place of its records,
+	 *		  empty unless the tree was constructed as TreeFormat::kNodePools.
+	 */
+	NodePools node_pools_;
+
+	/**
+	 * @brief Siblings ahead of the child being walked whose info sets and children
+	 *		  CFR and MCCFR prefetch, zero to turn prefetching off, and the info set
+	 *		  layout and precision ConstructTree built the regret table with.
+	 */
+	PrefetchOptions prefetch_;
+
+	/**
+	 * @brief Whether CFR and MCCFR walk the tree on an explicit stack rather than recursively.
+	 */
+	bool iterative_walks_;
+
+	/**
+	 * @brief Iterations after which CFR_ToAccuracy and MCCFR_ToAccuracy stop, accurate or not.
+	 */
+	int max_accuracy_iterations_;
+
+	/**
+	 * @brief Iterations the last CFR_ToAccuracy or MCCFR_ToAccuracy ran.
+	 */
+	int accuracy_iterations_;
+
+	/**
+	 * @brief Terminal memo lookups and hits of the last tree construction.
+	 */
+	long long terminal_lookups_;
+	long long terminal_memo_hits_;
+
+	/**
+	 * @brief Number of nodes a thread processes at once in level synchronous passes.
+	 */
+	static const long long kLevelGrainSize = 256;
+
+	/**
+	 * @brief Number of mutexes guarding info set updates in task parallel CFR.
+	 */
+	static const int kInfoSetLockStripes = 1024;
+
+	/**
+	 * @brief Number of independent subtrees per thread a parallel tree build aims for.
+	 */
+	static const int kSubtreesPerThread = 8;
+
+	/**
+	 * @brief Number of root to terminal paths sampled to order a TreeLayout::kVisitOrder tree.
+	 */
+	static const int kLayoutWarmupSamples = 1 << 16;
+
+	/**
+	 * @brief Prefetch distance of a new tree. Prefetching is off by default, as walks
+	 *		  of trees that fit in the last level cache only pay for the lookahead.
+	 */
+	static const int kDefaultPrefetchDistance = 0;
+
+	/**
+	 * @brief Number of terminal histories a subtree build hands to UtilityBatch() at once.
+	 */
+	static const int kUtilityBatchSize = 1024;
+
+	/**
+	 * @brief Largest declared fan-out that loops over the children of a node are unrolled for.
+	 */
+	static const int kMaxUnrolledFanOut = 8;
+
+	/**
+	 * @brief Iterations after which CFR_ToAccuracy and MCCFR_ToAccuracy of a new tree stop
+	 *		  short of the accuracy.
+	 */
+	static const int kDefaultMaxAccuracyIterations = 1 << 20;
+
 public:
 	typedef TreeNode<Action, PlayerNode, ChanceNode> CfrTreeNode;
 	typedef ClientNode<Action, PlayerNode, ChanceNode> CfrClientNode;
 
 	typedef std::vector<CfrTreeNode*> NodeList;
 	typedef std::vector<CfrTreeNode> HistoryList;
+	typedef DepthArena<CfrTreeNode> NodeArena;
+	typedef HistoryView<Action, PlayerNode, ChanceNode> CfrHistoryView;
+
+	/**
+	 * @brief Terminal utilities are evaluated in batches when the client implements UtilityBatch().
+	 */
+	static constexpr bool kBatchedUtility = CfrConcepts::UtilityBatchFunc<Action, PlayerNode, ChanceNode, GameClass>;
+
+	/**
+	 * @brief Terminal utilities are memoized by the client's terminal key when it implements TerminalKey().
+	 */
+	static constexpr bool kTerminalMemo = CfrConcepts::TerminalKeyFunc<Action, PlayerNode, ChanceNode, GameClass>;
 		
-	typedef std::unordered_map<std::string, int> InfoSetSizes;
-	typedef std::unordered_map<std::string, Byte*> InfoSetPositions;
+	/**
+	 * @brief Info sets are identified by 64 bit path hashes when the client provides
+	 *		  integer hash values, and by string history hashes otherwise.
+	 */
+	static constexpr bool kIntegerInfoSetHash = CfrConcepts::IntegerHashable<Action, PlayerNode, ChanceNode>;
+	typedef std::conditional_t<kIntegerInfoSetHash, std::uint64_t, std::string> InfoSetKey;
+	typedef std::conditional_t<kIntegerInfoSetHash,
+		InfoSetHashIndex, std::unordered_map<std::string, long long>> InfoSetIndex;
+
+	/**
+	 * @return Fan-out bounds declared by the client's GameClass, or zero when it declares none.
+	 */
+	static constexpr int DeclaredMaxActions() {
+		if constexpr (CfrConcepts::StaticMaxActions<GameClass>) {
+			return GameClass::kMaxActions;
+		}
+		else {
+			return 0;
+		}
+	}
+	static constexpr int DeclaredMaxChanceChildren() {
+		if constexpr (CfrConcepts::StaticMaxChanceChildren<GameClass>) {
+			return GameClass::kMaxChanceChildren;
+		}
+		else {
+			return 0;
+		}
+	}
+
+	static constexpr int kMaxActions = DeclaredMaxActions();
+	static constexpr int kMaxChanceChildren = DeclaredMaxChanceChildren();
+	static constexpr int kMaxChildren = kMaxActions > 0 && kMaxChanceChildren > 0
+		? ( kMaxActions > kMaxChanceChildren ? kMaxActions : kMaxChanceChildren ) : 0;
+
+	/**
+	 * @brief Scratch values for the actions of a player node, and for the children of any
+	 *		  node, held in fixed size stack arrays when the game bounds its fan-out.
+	 */
+	typedef std::conditional_t<( kMaxActions > 0 ),
+		FixedChildValues<( kMaxActions > 0 ? kMaxActions : 1 )>, ChildValues<>> ActionValues;
+	typedef std::conditional_t<( kMaxChildren > 0 ),
+		FixedChildValues<( kMaxChildren > 0 ? kMaxChildren : 1 )>, ChildValues<>> NodeValues;
+
+	/**
+	 * @brief Regret updates and chance sampling use loops unrolled to the declared bound
+	 *		  when it is small.
+	 */
+	static constexpr bool kUnrolledActions = kMaxActions > 0 && kMaxActions <= kMaxUnrolledFanOut;
+	static constexpr bool kUnrolledChance = kMaxChanceChildren > 0 && kMaxChanceChildren <= kMaxUnrolledFanOut;
+
+	/**
+	 * @brief Type the walks carry reach probabilities and node values in.
+	 */
+	typedef typename Policy::WalkValue WalkValue;
+
+	/**
+	 * @brief Scratch walk values for the children of any node.
+	 */
+	typedef std::conditional_t<( kMaxChildren > 0 ),
+		FixedChildValues<( kMaxChildren > 0 ? kMaxChildren : 1 ), WalkValue>, ChildValues<WalkValue>> NodeWalkValues;
+
+	/**
+	 * @brief Whether walks regret match each info set as they update it, rather than
+	 *		  the whole regret table after each pass.
+	 */
+	static constexpr bool kMatchPerVisit = Policy::kMatchTiming == CfrMatchTiming::kPerVisit;
+
+	/**
+	 * @return Whether a walk samples a single child of each chance node, as fixed by
+	 *		   the policy or, for CfrSampling::kPerCall, asked for by the solver method.
+	 */
+	static constexpr bool SamplesChance(bool with_sampling) {
+		if constexpr (Policy::kSampling == CfrSampling::kPerCall) {
+			return with_sampling;
+		}
+		else {
+			return Policy::kSampling == CfrSampling::kChanceSampled;
+		}
+	}
+
+	/**
+	 * @brief Node above the split depth of a parallel tree build, alongside
+	 *		  the client data needed to set it once subtree sizes are known.
+	 */
+	struct TopNode {
+		CfrTreeNode* node;
+		long long size_in_tree;
+		int num_children;
+		InfoSetKey info_set_key;
+		long long info_set_slot;
+	};
+	typedef std::vector<TopNode> TopLevel;
+
+	/**
+	 * @brief Terminal node of a subtree build waiting for its utility, with the
+	 *		  position of its record and of its history in the build's pending paths,
+	 *		  and its slot in the build's terminal memo, if any.
+	 */
+	struct PendingTerminal {
+		int depth;
+		std::size_t node_offset;
+		std::size_t path_start;
+		std::size_t path_size;
+		long long memo_slot;
+	};
+
+	/**
+	 * @brief Search tree nodes of a subtree built in a single pass, one buffer per depth.
+	 *		  Until the subtree is placed in the search tree, node records hold child
+	 *		  offsets relative to the next depth's buffer, and info set indices
+	 *		  into info_set_keys, in place of pointers.
+	 */
+	struct SubtreeBuild {
+		std::vector<std::vector<Byte>> depth_buffers;
+		InfoSetIndex info_set_indices;
+		std::vector<InfoSetKey> info_set_keys;
+		std::vector<int> info_set_num_actions;
+		NodeArena node_arena;
+
+		//Lists of actions and children of the node being built at each depth, reused between nodes.
+		std::deque<std::vector<Action>> depth_actions;
+		std::deque<std::vector<CfrClientNode>> depth_children;
+
+		//Probabilities of the children of the chance node being built, reused between nodes.
+		//They are copied into the node's record before the next node is built, so one list serves every depth.
+		std::vector<float> child_probabilities;
+
+		//Path from the root to the terminal node being evaluated, reused between terminals.
+		std::vector<const CfrTreeNode*> history_path;
+
+		//Terminals queued for the next UtilityBatch() call. Nodes on their paths are kept alive until then.
+		std::vector<PendingTerminal> pending_terminals;
+		std::vector<const CfrTreeNode*> pending_paths;
+		std::vector<CfrHistoryView> pending_views;
+		std::vector<float> pending_utilities;
+
+		//Utilities of the terminal keys seen so far. Slots from memo_ready_slots on belong to
+		//queued terminals, and terminals sharing their keys wait in pending_copies.
+		InfoSetHashIndex terminal_memo;
+		std::vector<float> memo_utilities;
+		long long memo_ready_slots = 0;
+		std::vector<PendingTerminal> pending_copies;
+		long long terminal_lookups = 0;
+		long long terminal_memo_hits = 0;
+		long long num_nodes = 0;
+
+		//Exception thrown while building the subtree, rethrown by ConstructTree on the calling thread.
+		std::exception_ptr error;
+	};
 
 	CfrTree(GameClass* gameInfo, ChanceNode rootNode) :
 		game_tree_{ nullptr }, regret_table_{ nullptr },
 		static_game_info_{ gameInfo }, starting_chance_node_{ rootNode },
-		search_tree_size_{ 0 }, info_set_table_size_{ 0 }
+		search_tree_size_{ 0 }, info_set_table_size_{ 0 }, num_nodes_{ 0 },
+		prefetch_{ kDefaultPrefetchDistance }, iterative_walks_{ false },
+		max_accuracy_iterations_{ kDefaultMaxAccuracyIterations }, accuracy_iterations_{ 0 },
+		terminal_lookups_{ 0 }, terminal_memo_hits_{ 0 }
 	{
 		std::srand(static_cast<unsigned>(std::time(nullptr)));
 	}
 
 	/**
 		* @brief Construct the game tree starting from the root chance node.
+		*		  With more than one thread, the top of the tree is expanded until there
+		*		  are enough independent subtrees, which are then explored and set,
+		*		  terminal utilities included, in parallel. The client's ActionList, Child,
+		*		  Children and UtilityFunc must then be safe to call concurrently.
+		*		  The resulting tree is the same for any number of threads.
+		*		  Errors found while building, on any thread, are thrown from this call.
+		* @param num_threads Number of threads to use, every hardware thread if below one.
+		* @param options Representation of the search tree and the regret table.
+		*		  With kNodePools NodePools are also built as an index over the search tree,
+		*		  finding the k-th child of a node without decoding its siblings. The index
+		*		  adds to the search tree's memory rather than replacing it, as every
+		*		  other walk still reads the records. kDepthFirst keeps every subtree contiguous, so deep walks stay
+		*		  within nearby memory. The traversal orders place info sets in the order
+		*		  CFR first updates them. kCacheAligned aligns every strategy and regret
+		*		  array for vector loads, at the cost of padding. kBFloat16 halves the
+		*		  cumulative strategy and regret, adding a little rounding noise.
+		* @throws std::runtime_error if two nodes of one info set have different action counts.
+		* @throws std::length_error if the tree is too large for the 32 bit children offsets
+		*		   or node pool references, or a node has more children than the game's
+		*		   kMaxActions or kMaxChanceChildren.
 		*/
-	void ConstructTree();
+	void ConstructTree(int num_threads = 1, const TreeOptions& options = {});
 
 	/**
-	 * @return The combined size of the regret table and search tree in bytes.
+	 * @return The combined size of the regret table, search tree and node pools in bytes.
 	 */
-	long long TreeSize() const { return search_tree_size_ + info_set_table_size_; }
+	long long TreeSize() const { return search_tree_size_ + info_set_table_size_ + node_pools_.SizeInBytes(); }
 
 	/**
 	 * @return The size of the search tree in bytes
 	 */
 	long long SearchTreeSize() const { return search_tree_size_; }
 
+	/**
+	 * @return The size of the node pools in bytes, zero unless built. This is memory on
+	 *		   top of SearchTreeSize(), as the pools index the search tree.
+	 */
+	long long NodePoolsSize() const { return node_pools_.SizeInBytes(); }
+
+	/**
+	 * @return The number of nodes in the search tree.
+	 */
+	long long NumNodes() const { return num_nodes_; }
+
 	/**
 	 * @return The size of the Info Set (Regret) table in bytes.
 	 */
 	long long InfoSetTableSize() const { return info_set_table_size_; }
 
+	/**
+	 * @return Number of terminal nodes looked up in the terminal memo while constructing
+	 *		   the tree, and how many of them reused a memoized utility. Both are zero
+	 *		   unless the client implements TerminalKey(). Every terminal is looked up
+	 *		   whatever the number of threads, but each subtree built on its own, and the
+	 *		   levels above them, keep their own memo, so hits fall as threads split the tree.
+	 */
+	long long TerminalMemoLookups() const { return terminal_lookups_; }
+	long long TerminalMemoHits() const { return terminal_memo_hits_; }
+
+	/**
+	 * @return Fraction of terminal memo lookups that skipped a utility evaluation.
+	 */
+	float TerminalMemoHitRate() const {
+		return terminal_lookups_ > 0 ? static_cast<float>(terminal_memo_hits_) / terminal_lookups_ : 0.0f;
+	}
+
+	/**
+	 * @brief Sets how many siblings ahead of the child being walked CFR and MCCFR
+	 *		  prefetch the info set and children of, hiding memory latency on trees
+	 *		  larger than the caches.
+	 * @param distance Siblings ahead to prefetch, zero or below to turn prefetching off.
+	 */
+	void SetPrefetchDistance(int distance) { prefetch_.distance = std::max(distance, 0); }
+
+	int PrefetchDistance() const { return prefetch_.distance; }
+
+	/**
+	 * @brief Sets whether CFR and MCCFR walk the search tree, or the node pools of
+	 *		  TreeFormat::kNodePools, on an explicit stack of frames rather than recursively,
+	 *		  the default. Both give the same results. The explicit stack walks trees of any
+	 *		  depth, but is slower than recursion on trees shallow enough to recurse.
+	 */
+	void SetIterativeWalks(bool iterative) { iterative_walks_ = iterative; }
+
+	bool IterativeWalks() const { return iterative_walks_; }
+
+	/**
+	 * @brief Sets the iterations after which CFR_ToAccuracy and MCCFR_ToAccuracy stop
+	 *		  even if the accuracy was not reached, as slow or noisy solves may never reach it.
+	 * @param max_iterations Iterations to stop after, at least one.
+	 */
+	void SetMaxAccuracyIterations(int max_iterations) { max_accuracy_iterations_ = std::max(max_iterations, 1); }
+
+	int MaxAccuracyIterations() const { return max_accuracy_iterations_; }
+
+	/**
+	 * @return Iterations the last CFR_ToAccuracy or MCCFR_ToAccuracy ran before reaching
+	 *		   its accuracy or MaxAccuracyIterations().
+	 */
+	int AccuracyIterations() const { return accuracy_iterations_; }
+
 	/**
 	 * @brief Prints out all nodes in the search tree and info sets in the regret table.
 	 */
@@ -114,7 +455,8 @@ public:
 
 	/**
 	 * @brief Runs CFR on the search tree / regret table, exploring every node
-	 *		  in the search tree for each iteration.
+	 *		  in the search tree for each iteration. Info sets are regret matched at
+	 *		  each visit, or after each pass under CfrMatchTiming::kPerPass.
 	 * @param iterations Number of iterations to update the entire tree.
 	 */
 	void CFR(int iterations);
@@ -128,51 +470,216 @@ public:
 
 	/**
 	 * @brief Runs CFR on the search tree / regret table, exploring every node
-	 *		  in the search tree for each iteration until desired accuracy is reached.
-	 *		  Accuracy is determined by summing the 2 players' value at the root node.
+	 *		  in the search tree for each iteration until desired accuracy is reached,
+	 *		  or MaxAccuracyIterations() have run.
+	 *		  Accuracy is the Exploitability() of the average strategy, a full best response,
+	 *		  checked first after 10 iterations and then after twice as many each time.
 	 * @param accuracy  Desired distance from nash equilibrium to reach.
 	 */
 	void CFR_ToAccuracy(float accuracy);
 
 	/**
 	 * @brief Runs CFR on the search tree / regret table, exploring a single subtree
-	 *		  of each chance node in the search tree for each iteration 
-			  until desired accuracy is reached.
-			  Accuracy is determined by summing the 2 players' value at the root node.
+	 *		  of each chance node in the search tree for each iteration
+	 *		  until desired accuracy is reached, or MaxAccuracyIterations() have run.
+	 *		  Accuracy is the Exploitability() of the average strategy, checked first after
+	 *		  5 iterations per child of the root and then after twice as many each time.
 	 * @param accuracy Desired distance from nash equilibrium to reach.
 	 */
 	void MCCFR_ToAccuracy(float accuracy);
 
+	/**
+	 * @brief Runs MCCFR with several threads sampling independent traversals at once.
+	 *		  Threads share the regret table without locking, in the style of Hogwild,
+	 *		  and each thread samples chance nodes with its own random generator.
+	 * @param iterations Number of iterations to update the tree, split across threads.
+	 * @param num_threads Number of threads to use, every hardware thread if below one.
+	 */
+	void MCCFR_Parallel(int iterations, int num_threads = 0);
+
+	/**
+	 * @brief Multithreaded MCCFR_ToAccuracy, on the same check schedule and iteration
+	 *		  bound. Sampled iterations between accuracy checks are shared across threads
+	 *		  as in MCCFR_Parallel.
+	 * @param accuracy Desired distance from nash equilibrium to reach.
+	 * @param num_threads Number of threads to use, every hardware thread if below one.
+	 */
+	void MCCFR_ToAccuracy(float accuracy, int num_threads);
+
+	/**
+	 * @brief Runs CFR on the search tree / regret table, exploring every node
+	 *		  in the search tree for each iteration, one depth at a time.
+	 *		  Reach probabilities are pushed down through each depth in parallel,
+	 *		  node values are then reduced back up, and regrets are applied once
+	 *		  per info set at the end of the iteration.
+	 *		  Every node of an info set plays the strategy it had at the start of the
+	 *		  pass, and its regrets are matched once at the end, so all of a player's
+	 *		  info sets update simultaneously. CFR instead matches an info set at each
+	 *		  visit, so its later nodes in the same pass play the new strategy. The two
+	 *		  are different algorithms and drift apart from the first iteration, unless
+	 *		  the policy sets CfrMatchTiming::kPerPass, under which CFR computes these
+	 *		  iterations too.
+	 * @param iterations Number of iterations to update the entire tree.
+	 * @param num_threads Number of threads to use, every hardware thread if below one.
+	 */
+	void CFR_LevelSynchronous(int iterations, int num_threads = 0);
+
+	/**
+	 * @brief Runs CFR on the search tree / regret table, exploring every node
+	 *		  in the search tree for each iteration. Children of any player or chance
+	 *		  node whose subtree holds more than grain_size nodes are forked as tasks,
+	 *		  which idle threads steal, so lopsided subtrees still keep every thread busy.
+	 *		  Updates to one info set are applied whole, regret matching included,
+	 *		  under a lock shared by that info set, in whichever order subtrees finish.
+	 * @param iterations Number of iterations to update the entire tree.
+	 * @param num_threads Number of threads to use, every hardware thread if below one.
+	 * @param grain_size Smallest subtree, in nodes, whose children are forked.
+	 */
+	void CFR_TaskParallel(int iterations, int num_threads = 0, long long grain_size = 4096);
+
+	/**
+	 * @brief Measures how far the average strategy is from a Nash equilibrium, taking
+	 *		  utilities as player one's payoff in a zero sum game.
+	 * @return Mean of what each player gains by switching to a best response against
+	 *		   the other's average strategy, zero at an equilibrium.
+	 */
+	float Exploitability() const;
+
 private:
 
 	/**
-		* @brief Helper method for PreProcessTree to process a single search node.
-		*		  Updates infoSetMap to track number of info sets and their sizes.
-		* @return Size of the search node in the search tree.
+		* @brief Expands the tree breadth first from the root until the deepest level
+		*		  holds at least min_subtrees nodes, or has no children left to expand.
+		* @param arena Arena the expanded nodes are created in, by depth.
+		* @return Nodes of each level. Nodes of the last level are left unexpanded.
+		*/
+	std::vector<TopLevel> ExpandTopLevels(CfrTreeNode* root, int min_subtrees, NodeArena& arena);
+
+	/**
+		* @brief Sets the expanded levels above the split depth in the search tree.
+		*		  Their terminals are memoized, batched and counted as a subtree's are.
+		* @param level_positions Offset of every node in each top level, including
+		*		  the roots of the subtrees in the last level.
 		*/
-	long long ExploreNode(
-		CfrTreeNode *search_node, InfoSetSizes &info_set_map,
-		std::vector<long long> &depth_map_size,
-		int curr_depth
+	void SetTopLevels(
+		std::vector<TopLevel>& top_levels,
+		const std::vector<std::vector<long long>>& level_positions,
+		const std::vector<Byte*>& info_set_positions
 	);
 
 	/**
-		* @brief Sets a single node in the search tree.
-		* @return Returns pointer to position to set next node.
+		* @brief Node on the path of a subtree build whose children are being built,
+		*		  with the arena mark its children are rewound to.
+		*/
+	struct BuildFrame {
+		CfrTreeNode* search_node;
+		int depth;
+		int num_children;
+		int next_child;
+		long long child_mark;
+	};
+
+	/**
+		* @brief Builds a node and its subtree into per depth buffers, calling the
+		*		  client once per node, depth first on an explicit stack of frames.
+		*		  Children are created in the build's arena, one depth below their parent,
+		*		  and destroyed once their subtree is built.
+		*/
+	void BuildSubtree(CfrTreeNode* subtree_root, SubtreeBuild& build);
+
+	/**
+		* @brief Builds a single node into its depth's buffer, and lists the actions or
+		*		  children of player and chance nodes in the build's lists for the depth.
+		*		  Updates the build's info sets for player nodes.
+		* @return Number of children of the node.
+		*/
+	int BuildNode(CfrTreeNode* search_node, int depth, SubtreeBuild& build);
+
+	/**
+		* @brief Copies a built subtree into the search tree, replacing relative child
+		*		  offsets and info set indices with pointers.
+		* @param cumulative_offsets Offset of the subtree at each depth of the search tree.
+		* @param info_set_slots Info set table slot of each of the subtree's info sets.
 		*/
-	void SetNode(
-		CfrTreeNode *search_node, int depth,
-		std::vector<long long> &cumulative_offsets,
-		InfoSetPositions &info_set_pos_map
+	void PlaceSubtree(
+		const SubtreeBuild& build, int split_depth,
+		const std::vector<long long>& cumulative_offsets,
+		const std::vector<long long>& info_set_slots,
+		const std::vector<Byte*>& info_set_positions
 	);
 
 	/**
-		* @brief Set all info sets in info set table
-		*		  Update info set pos map for player nodes in search tree.
+		* @return Key identifying the info set of a player node.
+		*/
+	static InfoSetKey InfoSetKeyOf(CfrTreeNode* search_node);
+
+	/**
+		* @brief Adds an info set key to an index, unless it is already present.
+		* @return The slot of the key, and whether it was inserted.
+		*/
+	static std::pair<long long, bool> InsertInfoSet(InfoSetIndex& index, const InfoSetKey& key, long long slot);
+
+	/**
+		* @brief Checks that a node found in an info set has as many actions as the info set,
+		*		  which a collision of 64 bit info set hashes, or a client giving the nodes of
+		*		  an info set different actions, would break.
+		* @throws std::runtime_error if the action counts differ.
+		*/
+	static void CheckInfoSetActions(int info_set_num_actions, int num_actions);
+
+	/**
+		* @return Client terminal key mixed by a bijection, so distinct keys stay distinct.
+		*/
+	static std::uint64_t MixTerminalKey(std::uint64_t key);
+
+	/**
+		* @brief Fills an empty list with the actions of a player node, letting the client
+		*		  write into it directly when it implements the output list ActionList().
+		* @throws std::length_error if there are more actions than the game's kMaxActions.
+		*/
+	void ActionList(const PlayerNode& player_node, std::vector<Action>& actions) const;
+
+	/**
+		* @brief Fills an empty list with the children of a chance node, letting the client
+		*		  write into it directly when it implements the output list Children().
+		* @throws std::length_error if there are more children than the game's kMaxChanceChildren.
+		*/
+	void ChildList(const ChanceNode& chance_node, std::vector<CfrClientNode>& children) const;
+
+	/**
+		* @brief Evaluates the client's utility at a terminal node, passing a view of
+		*		  its history when the client's UtilityFunc() accepts one, and a copied
+		*		  history list otherwise.
+		* @param history_path List the history view is built in, reused between calls.
+		*/
+	float TerminalUtility(CfrTreeNode* search_node, std::vector<const CfrTreeNode*>& history_path) const;
+
+	/**
+		* @brief Sets the utility of a terminal node of a subtree build, reusing the utility
+		*		  of an earlier terminal with the same key when the client gives terminal keys,
+		*		  and queueing the node when utilities are evaluated in batches.
+		*/
+	void BuildTerminal(CfrTreeNode* search_node, int depth, std::size_t node_offset, SubtreeBuild& build) const;
+
+	/**
+		* @brief Queues the terminal node whose history is in the build's history path for
+		*		  batched evaluation, evaluating the queue once it holds kUtilityBatchSize terminals.
+		*/
+	void QueueTerminal(int depth, std::size_t node_offset, long long memo_slot, SubtreeBuild& build) const;
+
+	/**
+		* @brief Evaluates every queued terminal of a subtree build in one UtilityBatch()
+		*		  call and sets their utilities in the build's buffers.
+		*/
+	void EvaluateTerminals(SubtreeBuild& build) const;
+
+	/**
+		* @brief Set all info sets in info set table, in slot order.
+		*		  Update info set positions for player nodes in search tree.
 		*/
 	void SetInfoSets(
-		InfoSetSizes& info_set_size_map,
-		InfoSetPositions& info_set_pos_map
+		const std::vector<int>& info_set_num_actions, InfoSetLayout info_set_layout,
+		InfoSetPrecision info_set_precision, std::vector<Byte*>& info_set_positions
 	) const;
 
 
@@ -181,86 +688,528 @@ private:
 	 *		  relevant information (including info sets)
 	 * @param node 
 	 */
-	static void PrintTreeRecursive(const SearchTreeNode& node);
+	static void PrintSubtree(const SearchTreeNode& node);
+
+	/**
+	 * @brief Children of a node on the path of a pre-order visit that are left to visit.
+	 */
+	struct ChildCursor {
+		Byte* next_child;
+		int remaining_children;
+	};
+
+	/**
+	 * @brief Calls visit on every node of the subtree of root in depth first pre-order,
+	 *		  keeping the path to the node on an explicit stack rather than recursing.
+	 */
+	template<typename Visit>
+	static void VisitPreOrder(const SearchTreeNode& root, Visit&& visit);
+
+	/**
+	 * @return Utility of a terminal to the player a walk updates. Utilities are player
+	 *		   one's payoff in a zero sum game, so player two's is their negation.
+	 */
+	static float UpdatedPlayerUtility(float utility, bool is_player_one) {
+		return is_player_one ? utility : -utility;
+	}
 
 	/**
 	 * @brief Recursively runs CFR on all nodes in search tree
 	 *		  with or without chance sampling.
-	 * @return The value of the subtree of a Search Tree Node.
+	 * @tparam kIsPlayerOne Player whose regrets the walk updates.
+	 * @tparam kSharedTable Whether other threads walk the regret table at the same time.
+	 *		   Info sets are then only read and updated through the relaxed atomic
+	 *		   accessors of InfoSetData, never by the vector kernels.
+	 * @tparam kSampled Whether a single child of each chance node is sampled.
+	 * @return The value of the subtree of a Search Tree Node, to that player.
 	 */
-	static float WalkTree(
-		SearchTreeNode& node, bool is_player_one, int iteration,
-		float player_one_reach_prob, float player_two_reach_prob, bool with_sampling
+	template<bool kIsPlayerOne, bool kSharedTable, bool kSampled>
+	static WalkValue WalkTree(
+		SearchTreeNode& node,
+		WalkValue player_one_reach_prob, WalkValue player_two_reach_prob,
+		PrefetchOptions prefetch, std::mt19937* rng = nullptr
 	);
 
+	/**
+	 * @brief Walks the children of a player node for WalkTree.
+	 * @tparam kActingPlayerOne Whether player one acts at the node, so the child loop
+	 *		   scales a single reach probability and the regret update is compiled
+	 *		   in only for the player the walk updates.
+	 */
+	template<bool kIsPlayerOne, bool kSharedTable, bool kSampled, bool kActingPlayerOne>
+	static WalkValue WalkTreePlayer(
+		SearchTreeNode& node,
+		WalkValue player_one_reach_prob, WalkValue player_two_reach_prob,
+		PrefetchOptions prefetch, std::mt19937* rng
+	);
 
 	/**
-	* @brief updates current strategy for an info set during an iteration of CFR.
-	*/
-	static void RegretMatching(InfoSetData& info_set);
-	
+	 * @brief Chance or player node on the path of an iterative CFR walk, with the reach
+	 *		  probabilities it was reached with, the value of the children walked so far,
+	 *		  and for player nodes the offset of its child utilities and current strategy
+	 *		  scratch on the walk's value stack.
+	 */
+	struct CfrWalkFrame {
+		ChildPrefetcher prefetcher;
+		Byte* next_child;
+		int num_children;
+		int child_index;
+		bool is_player_node;
+		bool is_player_one;
+		//Info set of a player node, or nullptr for chance nodes.
+		Byte* info_set_position;
+		//Probabilities of the children of a chance node, or the current strategy stored in the
+		//info set of a player node. nullptr when the current strategy is in the frame's scratch.
+		const float* child_weights;
+		WalkValue player_one_reach_prob;
+		WalkValue player_two_reach_prob;
+		WalkValue val;
+		WalkValue child_strat_prob;
+		std::size_t values_offset;
+
+		CfrWalkFrame(const SearchTreeNode& walked_node, const PrefetchOptions& prefetch,
+			WalkValue player_one_reach, WalkValue player_two_reach) :
+			prefetcher{ walked_node, prefetch },
+			next_child{ walked_node.ChildrenStartOffset() }, num_children{ walked_node.NumChildren() },
+			child_index{ 0 }, is_player_node{ walked_node.IsPlayerNode() },
+			is_player_one{ is_player_node && walked_node.IsPlayerOne() },
+			info_set_position{ is_player_node ? walked_node.InfoSetPosition() : nullptr },
+			child_weights{ is_player_node ? nullptr : walked_node.ChildProbabilitySpan().data() },
+			player_one_reach_prob{ player_one_reach }, player_two_reach_prob{ player_two_reach },
+			val{ 0 }, child_strat_prob{ 0 }, values_offset{ 0 } {}
+	};
+
 	/**
-	* @brief updates overall strategy for an info set after all iterations of CFR.
-	*/
-	static void AverageStrategy(
-		const SearchTreeNode& node, std::unordered_set<Byte*> already_evaluated
+	 * @brief Runs CFR on all nodes in the search tree as WalkTree does, on an explicit stack
+	 *		  of frames instead of the call stack, so the depth of the tree is not limited by
+	 *		  the thread's stack size. Each thread reuses its stack across walks.
+	 *		  Nodes are visited and updated in the same order as by WalkTree, so results match exactly.
+	 * @return The value of the root node.
+	 */
+	template<bool kIsPlayerOne, bool kSharedTable, bool kSampled>
+	static WalkValue WalkTreeIterative(
+		const SearchTreeNode& root,
+		PrefetchOptions prefetch, std::mt19937* rng = nullptr
 	);
-};
-			 
-/*
-#################################
-## Public Function Definitions ##
-#################################
-*/
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
-ConstructTree() {
-	
-	/*
-	########################################################
-	# Stage 1: Preprocessing tree to allocate correct size #
-	########################################################
-	*/
-	//Initialize Root node.
-	CfrTreeNode* root = new CfrTreeNode(starting_chance_node_);
 
-	//Initialize unordered map for current depth to track info set sizes.
-	InfoSetSizes info_set_sizes;
+	/**
+	 * @brief Chance or player node of the node pools on the path of an iterative walk,
+	 *		  as CfrWalkFrame is for the search tree.
+	 */
+	struct PoolsWalkFrame {
+		std::uint32_t index;
+		bool is_player_node;
+		bool is_player_one;
+		int num_children;
+		int child_index;
+		const float* child_weights;
+		WalkValue player_one_reach_prob;
+		WalkValue player_two_reach_prob;
+		WalkValue val;
+		WalkValue child_strat_prob;
+		std::size_t values_offset;
+
+		PoolsWalkFrame(const NodePools& pools, NodePools::NodeRef walked_node,
+			WalkValue player_one_reach, WalkValue player_two_reach) :
+			index{ NodePools::Index(walked_node) },
+			is_player_node{ NodePools::Type(walked_node) == NodePools::kPlayer },
+			is_player_one{ is_player_node && pools.IsPlayerOne(index) },
+			num_children{ is_player_node ? pools.PlayerNumChildren(index) : pools.ChanceNumChildren(index) },
+			child_index{ 0 }, child_weights{ is_player_node ? nullptr : pools.ChildProbabilities(index) },
+			player_one_reach_prob{ player_one_reach }, player_two_reach_prob{ player_two_reach },
+			val{ 0 }, child_strat_prob{ 0 }, values_offset{ 0 } {}
+	};
 
-	//Initialize unordered map to track size at each depth of the tree.
-	std::vector<long long> depth_sizes;
+	/**
+	 * @return Probabilities of the children of the node of a frame: the chance probabilities
+	 *		   of a chance node, or the current strategy of a player node, stored in its info set
+	 *		   or in the frame's scratch on the value stack, for info sets that derive it and
+	 *		   for walks of a shared table.
+	 */
+	template<typename Frame>
+	static const float* ChildWeights(WalkStack<Frame>& stack, const Frame& frame);
 
-	//Explore all children and update info set and depth size maps.
-	long long search_tree_size = ExploreNode(root, info_set_sizes, depth_sizes, 0);
+	/**
+	 * @brief Adds the value of the child being walked to its parent's frame, weighted by the
+	 *		  child's probability, and moves the frame to its next child.
+	 */
+	template<typename Frame>
+	static void AddChildValue(WalkStack<Frame>& stack, Frame& parent, WalkValue child_value);
 
-	//Get info set size from the infoSetSizes map.
-	long long info_set_size = 0;
+	/**
+	 * @brief Recursively runs CFR on a node of the node pools, as WalkTree does on the search tree.
+	 * @return The value of the subtree of the node.
+	 */
+	template<bool kIsPlayerOne, bool kSharedTable, bool kSampled>
+	static WalkValue WalkPools(
+		const NodePools& pools, NodePools::NodeRef node,
+		WalkValue player_one_reach_prob, WalkValue player_two_reach_prob,
+		PrefetchOptions prefetch, std::mt19937* rng = nullptr
+	);
 
-	for (const auto& [key, val] : info_set_sizes ) {
-		info_set_size += TreeUtils::InfoSetSize(val);
-	}
-	/*
-	##############################
-	## Stage 2: Allocate memory ##
-	##############################
-	*/
+	/**
+	 * @brief Runs CFR on the node pools as WalkPools does, on an explicit stack of frames
+	 *		  as WalkTreeIterative does for the search tree.
+	 * @return The value of the root node.
+	 */
+	template<bool kIsPlayerOne, bool kSharedTable, bool kSampled>
+	static WalkValue WalkPoolsIterative(
+		const NodePools& pools, PrefetchOptions prefetch, std::mt19937* rng = nullptr
+	);
 
-	this->game_tree_ = new Byte[search_tree_size];
-	this->regret_table_ = new Byte[info_set_size];
-	search_tree_size_ = search_tree_size;
-	info_set_table_size_ = info_set_size;
+	/**
+	 * @return Child of a chance node in the node pools, sampled with rng, or with
+	 *		   std::rand() when rng is nullptr.
+	 */
+	static NodePools::NodeRef SampledChanceChild(const NodePools& pools, std::uint32_t index, std::mt19937* rng);
 
-	/*
-	########################################################
-	## Stage 3: Set Info Sets and update their positions  ##
-	########################################################
-	*/
+	/**
+	 * @brief Walks the children of a player node for WalkPools, as WalkTreePlayer does.
+	 */
+	template<bool kIsPlayerOne, bool kSharedTable, bool kSampled, bool kActingPlayerOne>
+	static WalkValue WalkPoolsPlayer(
+		const NodePools& pools, std::uint32_t index,
+		WalkValue player_one_reach_prob, WalkValue player_two_reach_prob,
+		PrefetchOptions prefetch, std::mt19937* rng
+	);
 
-	InfoSetPositions info_set_positions;
-	SetInfoSets(info_set_sizes, info_set_positions);
+	/**
+	 * @return Child of a chance node in the node pools sampled for rand_float, the same child
+	 *		   NodePools::SampleChild() returns. For a small declared chance fan-out the children
+	 *		   are counted in a loop unrolled to the bound, without branches.
+	 */
+	static int SampleChanceChild(const NodePools& pools, std::uint32_t index, float rand_float);
 
-	/*
+	/**
+	 * @brief Runs one CFR iteration for a single player from the root, on the node
+	 *		  pools when they were built, otherwise on the search tree.
+	 * @param shared_table Whether other threads walk the regret table at the same time.
+	 * @return The value of the root node.
+	 */
+	float WalkRoot(bool is_player_one, bool with_sampling, std::mt19937* rng = nullptr,
+		bool shared_table = false);
+
+	/**
+	 * @brief Runs one CFR iteration of CFR or CFR_ToAccuracy, a pass for each player,
+	 *		  regret matching the regret table after each pass under CfrMatchTiming::kPerPass.
+	 */
+	void WalkFullIteration();
+
+	/**
+	 * @brief WalkRoot for a regret table that is, or is not, shared between threads,
+	 *		  and for walks that do, or do not, sample chance nodes.
+	 */
+	template<bool kSharedTable, bool kSampled>
+	float WalkRootOf(bool is_player_one, std::mt19937* rng);
+
+	/**
+	 * @return Current strategy of an info set for a walk. Walks of a shared table always
+	 *		   copy it into scratch, which must hold NumActions() floats, with relaxed loads.
+	 */
+	static const float* WalkStrategy(InfoSetData& info_set, float* scratch, bool shared_table) {
+		return shared_table ? info_set.LoadCurrentStrategy(scratch) : info_set.CurrentStrategy(scratch);
+	}
+
+	/**
+	 * @brief Runs sampled CFR iterations [first_iteration, first_iteration + iterations)
+	 *		  across the thread pool, seeding a generator for each thread's share.
+	 */
+	void WalkSampledTrees(CfrThreadPool& pool, int first_iteration, int iterations);
+
+
+	/**
+	 * @brief Runs one level synchronous CFR iteration for a single player.
+	 * @return The value of the root node.
+	 */
+	static WalkValue WalkLevels(
+		const TreeLevelIndex& levels, CfrThreadPool& pool, bool is_player_one,
+		std::vector<WalkValue>& player_one_reach, std::vector<WalkValue>& player_two_reach,
+		std::vector<WalkValue>& node_values
+	);
+
+	/**
+	 * @brief Recursively runs CFR on the subtree of a node in the level index,
+	 *		  forking the children of large subtrees onto the thread pool.
+	 * @return The value of the subtree.
+	 */
+	static WalkValue WalkTreeTasks(
+		const TreeLevelIndex& levels, CfrThreadPool& pool, std::vector<std::mutex>& info_set_locks,
+		long long node_index, bool is_player_one,
+		WalkValue player_one_reach_prob, WalkValue player_two_reach_prob, long long grain_size
+	);
+
+	/**
+	 * @brief Adds the regrets and strategy of a single player node visit to its info set,
+	 *		  given the current strategy the visit walked its children with.
+	 *		  Walks that share the regret table between threads pass their own snapshot of
+	 *		  the strategy, which another thread's RegretMatching may since have replaced.
+	 * @param shared_table Whether other threads read or update the info set at the same
+	 *		  time, so it is updated through InfoSetData's relaxed atomic accessors.
+	 */
+	static void AccumulateRegrets(
+		InfoSetData& info_set, const float* current_strategy, const float* child_utilities, float val,
+		float regret_prob, float strat_prob, bool shared_table
+	);
+
+	/**
+	* @brief updates current strategy for an info set during an iteration of CFR.
+	*		 Info sets that derive their current strategy only go back to deriving it
+	*		 from their regrets, after AverageStrategy.
+	* @param shared_table As for AccumulateRegrets.
+	*/
+	static void RegretMatching(InfoSetData& info_set, bool shared_table);
+
+	/**
+	 * @brief Regret matches every info set of the regret table, after a pass of walks
+	 *		  that left it to the end under CfrMatchTiming::kPerPass.
+	 * @param shared_table As for AccumulateRegrets.
+	 */
+	void MatchRegretTable(bool shared_table);
+
+	/**
+	 * @brief Regret matches a snapshot of an info set's regrets in place, and stores the
+	 *		  result as its current strategy with relaxed stores, for shared tables.
+	 */
+	static void StoreMatchedStrategy(InfoSetData& info_set, float* regrets);
+	
+	/**
+	* @brief updates overall strategy for an info set after all iterations of CFR.
+	*		 Info sets that derive their current strategy read the average as it
+	*		 until their next regret update.
+	*/
+	static void AverageStrategy(
+		const SearchTreeNode& node, std::unordered_set<Byte*>& already_evaluated
+	);
+
+	/**
+	 * @brief Best response of one player to the other's average strategy. Holds the
+	 *		  nodes of each of the responder's info sets with the probability chance
+	 *		  and the opponent reach them with, and memoizes node values and actions.
+	 */
+	struct BestResponse {
+		bool is_player_one = true;
+		std::unordered_map<Byte*, std::vector<std::pair<Byte*, float>>> info_set_nodes;
+		std::unordered_map<Byte*, int> actions;
+		std::unordered_map<Byte*, float> node_values;
+	};
+
+	/**
+	 * @brief Node on the path of CollectBestResponseNodes, with the probability chance
+	 *		  and the opponent reach it with, and the offset of its children's
+	 *		  probabilities on the walk's value stack.
+	 */
+	struct ReachCursor {
+		Byte* next_child;
+		int num_children;
+		int child_index;
+		float reach_prob;
+		std::size_t probs_offset;
+	};
+
+	/**
+	 * @brief Records the nodes of the responder's info sets in the subtree of a node,
+	 *		  keeping the path to each on an explicit stack.
+	 */
+	static void CollectBestResponseNodes(Byte* root_pos, BestResponse& best_response);
+
+	/**
+	 * @brief Frame of BestResponseValue. Computes either the value of a node, or, when
+	 *		  node_pos is nullptr, the action the responder takes in an info set: the one
+	 *		  of highest value summed over the info set's nodes, whose children it walks
+	 *		  node by node.
+	 */
+	struct BestResponseFrame {
+		Byte* node_pos = nullptr;
+		Byte* info_set_pos = nullptr;
+		const std::vector<std::pair<Byte*, float>>* info_set_nodes = nullptr;
+		//nullptr for a node of the responder until the action of its info set is known.
+		Byte* next_child = nullptr;
+		int num_children = 0;
+		int child_index = 0;
+		int num_actions = 0;
+		//Child probabilities of a chance or opponent node, or action values of an info set,
+		//on the walk's value stack. Nodes of the responder take their one child's value.
+		std::size_t values_offset = 0;
+		int num_values = 0;
+		float val = 0;
+	};
+
+	/**
+	 * @return Value of a node to the responder, walking the nodes whose values are not
+	 *		   yet memoized on an explicit stack.
+	 */
+	static float BestResponseValue(Byte* root_pos, BestResponse& best_response);
+
+	/**
+	 * @brief Gets the value of a terminal node, or of a node whose value is memoized.
+	 * @return Whether the value is known.
+	 */
+	static bool KnownBestResponseValue(Byte* node_pos, const BestResponse& best_response, float& value);
+
+	/**
+	 * @brief Pushes the frame computing the value of a node, and, for a node of the
+	 *		  responder whose info set has no action yet, the frame computing it on top.
+	 */
+	static void PushBestResponseNode(WalkStack<BestResponseFrame>& stack, Byte* node_pos, BestResponse& best_response);
+
+	/**
+	 * @return Position of the k-th child of a player or chance node.
+	 */
+	static Byte* ChildPosition(const SearchTreeNode& node, int i_child);
+
+	/**
+	 * @brief Writes the average strategy of an info set, or the uniform strategy
+	 *		  before any has accumulated, into strategy.
+	 */
+	static void AverageStrategyOf(InfoSetData& info_set, float* strategy);
+};
+			 
+/*
+#################################
+## Public Function Definitions ##
+#################################
+*/
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+ConstructTree(
+	int num_threads, const TreeOptions& options
+) {
+	
+	CfrThreadPool pool{ num_threads };
+
+	/*
+	##########################################################
+	# Stage 1: Building subtrees to find the size of the tree #
+	##########################################################
+	*/
+	//Nodes above the split depth live until the tree is set, and are released together.
+	NodeArena top_arena;
+
+	//Initialize Root node.
+	CfrTreeNode* root = top_arena.Create(0, starting_chance_node_);
+
+	//Expand the top of the tree until there are enough subtrees to share between threads.
+	const int min_subtrees = pool.NumThreads() > 1 ? kSubtreesPerThread * pool.NumThreads() : 1;
+	std::vector<TopLevel> top_levels = ExpandTopLevels(root, min_subtrees, top_arena);
+	const int split_depth = static_cast<int>(top_levels.size()) - 1;
+	const TopLevel& subtree_roots = top_levels.back();
+	const long long num_subtrees = static_cast<long long>(subtree_roots.size());
+
+	//Build all subtrees in a single pass each, with their own buffers and info sets.
+	std::vector<SubtreeBuild> subtree_builds(num_subtrees);
+	pool.ParallelFor(0, num_subtrees, 1, [&](long long i_begin, long long i_end) {
+		for (long long i_subtree = i_begin; i_subtree < i_end; i_subtree++) {
+			try {
+				BuildSubtree(subtree_roots[i_subtree].node, subtree_builds[i_subtree]);
+				EvaluateTerminals(subtree_builds[i_subtree]);
+			}
+			catch (...) {
+				subtree_builds[i_subtree].error = std::current_exception();
+			}
+		}
+	});
+	for (const SubtreeBuild& build : subtree_builds) {
+		if (build.error) {
+			std::rethrow_exception(build.error);
+		}
+	}
+	terminal_lookups_ = 0;
+	terminal_memo_hits_ = 0;
+	num_nodes_ = 0;
+	for (const SubtreeBuild& build : subtree_builds) {
+		terminal_lookups_ += build.terminal_lookups;
+		terminal_memo_hits_ += build.terminal_memo_hits;
+		num_nodes_ += build.num_nodes;
+	}
+
+	//Initialize index and slot list to track info sets and their sizes.
+	InfoSetIndex info_set_indices;
+	std::vector<int> info_set_num_actions;
+
+	//Initialize unordered map to track size at each depth of the tree.
+	std::vector<long long> depth_sizes(split_depth, 0);
+
+	//Nodes above the split depth were already sized while expanding them.
+	for (int depth = 0; depth < split_depth; depth++) {
+		num_nodes_ += static_cast<long long>(top_levels[depth].size());
+		for (TopNode& top_node : top_levels[depth]) {
+			depth_sizes[depth] += top_node.size_in_tree;
+			if (top_node.node->IsPlayerNode()) {
+				auto [slot, inserted] = InsertInfoSet(info_set_indices, top_node.info_set_key,
+					static_cast<long long>(info_set_num_actions.size()));
+				if (inserted) {
+					info_set_num_actions.push_back(top_node.num_children);
+				}
+				CheckInfoSetActions(info_set_num_actions[slot], top_node.num_children);
+				top_node.info_set_slot = slot;
+			}
+		}
+	}
+
+	//Merge subtree info sets and sizes, subtree depths start at the split depth.
+	std::vector<std::vector<long long>> subtree_info_set_slots(num_subtrees);
+	for (long long i_subtree = 0; i_subtree < num_subtrees; i_subtree++) {
+		const SubtreeBuild& build = subtree_builds[i_subtree];
+		for (std::size_t i_info_set = 0; i_info_set < build.info_set_keys.size(); i_info_set++) {
+			auto [slot, inserted] = InsertInfoSet(info_set_indices, build.info_set_keys[i_info_set],
+				static_cast<long long>(info_set_num_actions.size()));
+			if (inserted) {
+				info_set_num_actions.push_back(build.info_set_num_actions[i_info_set]);
+			}
+			CheckInfoSetActions(info_set_num_actions[slot], build.info_set_num_actions[i_info_set]);
+			subtree_info_set_slots[i_subtree].push_back(slot);
+		}
+		for (int i_depth = 0; i_depth < static_cast<int>(build.depth_buffers.size()); i_depth++) {
+			if (static_cast<int>(depth_sizes.size()) <= split_depth + i_depth) {
+				depth_sizes.push_back(0);
+			}
+			depth_sizes[split_depth + i_depth] += static_cast<long long>(build.depth_buffers[i_depth].size());
+		}
+	}
+	long long search_tree_size = 0;
+	for (const long long depth_size : depth_sizes) {
+		search_tree_size += depth_size;
+	}
+
+	//Children offsets are 32 bit. A node is less than its depth and the next one away from
+	//its children, or less than the whole tree once laid out depth first. Checked before
+	//allocating, as subtrees are placed on pool threads.
+	for (std::size_t depth = 0; depth < depth_sizes.size(); depth++) {
+		const long long next_size = depth + 1 < depth_sizes.size() ? depth_sizes[depth + 1] : 0;
+		TreeUtils::CheckedChildrenOffset(depth_sizes[depth] + next_size);
+	}
+	if (options.layout != TreeLayout::kDepthOrder) {
+		TreeUtils::CheckedChildrenOffset(search_tree_size);
+	}
+
+	//Get info set size from the number of actions of each info set.
+	long long info_set_size = 0;
+
+	for (const int num_actions : info_set_num_actions) {
+		info_set_size += TreeUtils::InfoSetSize(num_actions, options.info_set_layout, options.info_set_precision);
+	}
+	/*
+	##############################
+	## Stage 2: Allocate memory ##
+	##############################
+	*/
+
+	this->game_tree_ = new Byte[search_tree_size];
+	this->regret_table_ = TreeUtils::AllocateRegretTable(info_set_size);
+	search_tree_size_ = search_tree_size;
+	info_set_table_size_ = info_set_size;
+
+	/*
+	########################################################
+	## Stage 3: Set Info Sets and update their positions  ##
+	########################################################
+	*/
+
+	std::vector<Byte*> info_set_positions;
+	SetInfoSets(info_set_num_actions, options.info_set_layout, options.info_set_precision, info_set_positions);
+
+	/*
 	####################################
 	## Stage 3: Set Search Tree nodes ##
 	####################################
@@ -274,98 +1223,233 @@ ConstructTree() {
 		offset_at_depth += depth_size;
 		depth_offsets.push_back(offset_at_depth);
 	}
-	//Set nodes 
-	SetNode(root, 0, depth_offsets, info_set_positions);
 
+	//Each subtree starts at its depth's offset plus the sizes of earlier subtrees at that depth.
+	std::vector<std::vector<long long>> subtree_offsets(num_subtrees, depth_offsets);
+	for (long long i_subtree = 1; i_subtree < num_subtrees; i_subtree++) {
+		const std::vector<std::vector<Byte>>& prev_buffers = subtree_builds[i_subtree - 1].depth_buffers;
+		for (int i_depth = split_depth; i_depth < static_cast<int>(depth_offsets.size()); i_depth++) {
+			const int i_prev_depth = i_depth - split_depth;
+			const long long prev_size = i_prev_depth < static_cast<int>(prev_buffers.size()) ?
+				static_cast<long long>(prev_buffers[i_prev_depth].size()) : 0;
+			subtree_offsets[i_subtree][i_depth] = subtree_offsets[i_subtree - 1][i_depth] + prev_size;
+		}
+	}
+
+	//Set nodes above the split depth, then every subtree in parallel.
+	std::vector<std::vector<long long>> level_positions(split_depth + 1);
+	for (int depth = 0; depth < split_depth; depth++) {
+		long long position = depth_offsets[depth];
+		for (const TopNode& top_node : top_levels[depth]) {
+			level_positions[depth].push_back(position);
+			position += top_node.size_in_tree;
+		}
+	}
+	for (long long i_subtree = 0; i_subtree < num_subtrees; i_subtree++) {
+		level_positions[split_depth].push_back(subtree_offsets[i_subtree][split_depth]);
+	}
+	SetTopLevels(top_levels, level_positions, info_set_positions);
+
+	pool.ParallelFor(0, num_subtrees, 1, [&](long long i_begin, long long i_end) {
+		for (long long i_subtree = i_begin; i_subtree < i_end; i_subtree++) {
+			PlaceSubtree(subtree_builds[i_subtree], split_depth, subtree_offsets[i_subtree],
+				subtree_info_set_slots[i_subtree], info_set_positions);
+		}
+	});
+
+	/*
+	######################################################
+	## Stage 4: Lay out the search tree and info sets  ##
+	######################################################
+	*/
+	if (options.layout != TreeLayout::kDepthOrder) {
+		std::unordered_map<Byte*, long long> visit_counts;
+		if (options.layout == TreeLayout::kVisitOrder) {
+			visit_counts = SearchTreeLayout::SampleVisitCounts(game_tree_, kLayoutWarmupSamples,
+				static_cast<unsigned>(std::rand()));
+		}
+		Byte* laid_out_tree = new Byte[search_tree_size];
+		SearchTreeLayout::CopyDepthFirst(game_tree_, laid_out_tree,
+			options.layout == TreeLayout::kVisitOrder ? &visit_counts : nullptr);
+		delete[] game_tree_;
+		game_tree_ = laid_out_tree;
+	}
+	if (options.info_set_order != InfoSetOrder::kBuildOrder) {
+		Byte* ordered_table = TreeUtils::AllocateRegretTable(info_set_size);
+		SearchTreeLayout::CopyInfoSets(game_tree_, ordered_table, options.info_set_order);
+		TreeUtils::FreeRegretTable(regret_table_);
+		regret_table_ = ordered_table;
+	}
+
+	/*
+	####################################
+	## Stage 5: Build the node pools  ##
+	####################################
+	*/
+	node_pools_ = options.format == TreeFormat::kNodePools ? NodePools{ game_tree_ } : NodePools{};
+	prefetch_.info_set_layout = options.info_set_layout;
+	prefetch_.info_set_precision = options.info_set_precision;
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
 PrintTree() const
 {
 	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
-	PrintTreeRecursive(root_chance);
+	PrintSubtree(root_chance);
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
 CFR(int iterations) {
 
-	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
 	for (int i_cfr = 0; i_cfr < iterations; i_cfr++) {
 		
-		WalkTree(root_chance, true, i_cfr, 1, 1, false);
-		WalkTree(root_chance, false, i_cfr, 1, 1, false);
+		WalkFullIteration();
 	}
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
 MCCFR(int iterations) {
+	static_assert(kMatchPerVisit, "CfrMatchTiming::kPerPass would rematch the whole regret table after every sampled walk");
 	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
 	for (int i_cfr = 0; i_cfr < iterations; i_cfr++) {
 
-		WalkTree(root_chance, true, i_cfr, 1, 1, true);
-		WalkTree(root_chance, false, i_cfr, 1, 1, true);
+		WalkRoot(true, true);
+		WalkRoot(false, true);
 	}
 	std::unordered_set<Byte*> seen_info_sets;
 	AverageStrategy(root_chance, seen_info_sets);
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
 CFR_ToAccuracy(float accuracy) {
 
-	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
-	int iters_pet_exploitability_check = 10;
-	float exploitability = 100.0;
+	int iters_per_exploitability_check = 10;
 	int i = 0;
-	while (exploitability > accuracy) {
-		for (int iCfr = 0; iCfr < iters_pet_exploitability_check - 1; iCfr++) {
+	while (i < max_accuracy_iterations_) {
+		const int check_at = i + std::min(iters_per_exploitability_check, max_accuracy_iterations_ - i);
+		for (; i < check_at; i++) {
 
-			WalkTree(root_chance, true, i, 1, 1, false);
-			WalkTree(root_chance, false, i, 1, 1, false);
-			i++;
+			WalkFullIteration();
 		}
-		//One last iteration to calculate exploit-ability
-		WalkTree(root_chance, true, i, 1, 1, false);
-		WalkTree(root_chance, false, i, 1, 1, false);
-		
-		i++;
+		if (Exploitability() <= accuracy) {
+			break;
+		}
+		iters_per_exploitability_check = std::min(2 * iters_per_exploitability_check, max_accuracy_iterations_);
 	}
+	accuracy_iterations_ = i;
+	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
+	std::unordered_set<Byte*> seen_info_sets;
+	AverageStrategy(root_chance, seen_info_sets);
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
 MCCFR_ToAccuracy(float accuracy) {
+	static_assert(kMatchPerVisit, "CfrMatchTiming::kPerPass would rematch the whole regret table after every sampled walk");
 
 	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
-	const int iters_pet_exploitability_check = root_chance.NumChildren() * 5;
-	float exploitability = std::numeric_limits<float>::infinity();
+	int iters_per_exploitability_check = root_chance.NumChildren() * 5;
 	int i = 0;
-	while (exploitability > accuracy) {
-		for (int i_cfr = 0; i_cfr < iters_pet_exploitability_check - 1; i_cfr++) {
+	while (i < max_accuracy_iterations_) {
+		const int check_at = i + std::min(iters_per_exploitability_check, max_accuracy_iterations_ - i);
+		for (; i < check_at; i++) {
 
-			WalkTree(root_chance, true, i, 1, 1, true);
-			WalkTree(root_chance, false, i, 1, 1, true);
-			i++;
+			WalkRoot(true, true);
+			WalkRoot(false, true);
 		}
-		//One last iteration to calculate exploit ability
-		float player_one_ev = WalkTree(root_chance, true, i, 1, 1, true);
-		float playerTwoEv = WalkTree(root_chance, false, i, 1, 1, true);
-		
-		exploitability = player_one_ev - playerTwoEv;
-		i++;
+		if (Exploitability() <= accuracy) {
+			break;
+		}
+		iters_per_exploitability_check = std::min(2 * iters_per_exploitability_check, max_accuracy_iterations_);
+	}
+	accuracy_iterations_ = i;
+	std::unordered_set<Byte*> seen_info_sets;
+	AverageStrategy(root_chance, seen_info_sets);
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+MCCFR_Parallel(int iterations, int num_threads) {
+	static_assert(kMatchPerVisit, "CfrMatchTiming::kPerPass would rematch the whole regret table after every sampled walk");
+
+	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
+	CfrThreadPool pool{ num_threads };
+	WalkSampledTrees(pool, 0, iterations);
+
+	std::unordered_set<Byte*> seen_info_sets;
+	AverageStrategy(root_chance, seen_info_sets);
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+MCCFR_ToAccuracy(float accuracy, int num_threads) {
+	static_assert(kMatchPerVisit, "CfrMatchTiming::kPerPass would rematch the whole regret table after every sampled walk");
+
+	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
+	CfrThreadPool pool{ num_threads };
+	int iters_per_exploitability_check = root_chance.NumChildren() * 5;
+	int i = 0;
+	while (i < max_accuracy_iterations_) {
+		const int batch = std::min(iters_per_exploitability_check, max_accuracy_iterations_ - i);
+		WalkSampledTrees(pool, i, batch);
+		i += batch;
+		if (Exploitability() <= accuracy) {
+			break;
+		}
+		iters_per_exploitability_check = std::min(2 * iters_per_exploitability_check, max_accuracy_iterations_);
 	}
+	accuracy_iterations_ = i;
 	std::unordered_set<Byte*> seen_info_sets;
 	AverageStrategy(root_chance, seen_info_sets);
 }
 
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+CFR_TaskParallel(int iterations, int num_threads, long long grain_size) {
+
+	const TreeLevelIndex levels{ game_tree_ };
+	CfrThreadPool pool{ num_threads };
+	std::vector<std::mutex> info_set_locks(kInfoSetLockStripes);
+	for (int i_cfr = 0; i_cfr < iterations; i_cfr++) {
+
+		for (const bool is_player_one : { true, false }) {
+			pool.RunTasks([&] { WalkTreeTasks(levels, pool, info_set_locks, 0, is_player_one, 1, 1, grain_size); });
+			if constexpr (!kMatchPerVisit) {
+				MatchRegretTable(false);
+			}
+		}
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+CFR_LevelSynchronous(int iterations, int num_threads) {
+
+	const TreeLevelIndex levels{ game_tree_ };
+	CfrThreadPool pool{ num_threads };
+	std::vector<WalkValue> player_one_reach(levels.NumNodes());
+	std::vector<WalkValue> player_two_reach(levels.NumNodes());
+	std::vector<WalkValue> node_values(levels.NumNodes());
+	for (int i_cfr = 0; i_cfr < iterations; i_cfr++) {
+
+		WalkLevels(levels, pool, true, player_one_reach, player_two_reach, node_values);
+		WalkLevels(levels, pool, false, player_one_reach, player_two_reach, node_values);
+	}
+}
+
 /*
 ##################################
 ## Private Function Definitions ##
@@ -380,320 +1464,1556 @@ MCCFR_ToAccuracy(float accuracy) {
 */
 
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline long long CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
-ExploreNode(
-	CfrTreeNode* search_node, InfoSetSizes& info_set_map,
-	std::vector<long long>& depth_map_size, int curr_depth
-) {
-
-	if (static_cast<int>( depth_map_size.size()) <= curr_depth)
-	{
-		depth_map_size.push_back(0);
-	}
-	long curr_node_size;
-	long sub_tree_size = 0;
-	if (search_node->IsPlayerNode()) {
-		
-		PlayerNode curr_node = search_node->GetPlayerNode();
-		std::vector<Action> actions = curr_node.ActionList(static_game_info_);
-		curr_node_size = TreeUtils::kPlayerNodeSize;
-		for (Action a : actions) {
-			CfrTreeNode child = curr_node.Child(a, static_game_info_);
-
-			//Allocate child, and explore it.
-			CfrTreeNode* next_child = new CfrTreeNode(child, search_node);
-			sub_tree_size += ExploreNode(next_child, info_set_map, depth_map_size, curr_depth + 1);
-			delete next_child;
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline std::vector<typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::TopLevel>
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+ExpandTopLevels(CfrTreeNode* root, int min_subtrees, NodeArena& arena) {
+
+	std::vector<TopLevel> top_levels(1);
+	top_levels[0].push_back({ root, 0, 0, {}, 0 });
+	std::vector<Action> actions;
+	std::vector<CfrClientNode> children;
+	while (static_cast<int>(top_levels.back().size()) < min_subtrees) {
+		const int child_depth = static_cast<int>(top_levels.size());
+		TopLevel next_level;
+		for (TopNode& top_node : top_levels.back()) {
+			CfrTreeNode* search_node = top_node.node;
+			if (search_node->IsPlayerNode()) {
+
+				const PlayerNode& curr_node = search_node->GetPlayerNode();
+				actions.clear();
+				ActionList(curr_node, actions);
+				top_node.size_in_tree = TreeUtils::PlayerNodeSizeInTree(static_cast<int>(actions.size()));
+				top_node.num_children = static_cast<int>(actions.size());
+				top_node.info_set_key = InfoSetKeyOf(search_node);
+				for (const Action& a : actions) {
+					CfrClientNode child = curr_node.Child(a, static_game_info_);
+					next_level.push_back({ arena.Create(child_depth, std::move(child), search_node), 0, 0, {}, 0 });
+				}
+			}
+			else if (search_node->IsChanceNode()) {
+
+				const ChanceNode& curr_node = search_node->GetChanceNode();
+				children.clear();
+				ChildList(curr_node, children);
+				top_node.size_in_tree = TreeUtils::ChanceNodeSizeInTree(children.size());
+				top_node.num_children = static_cast<int>(children.size());
+				for (CfrClientNode& child : children) {
+					next_level.push_back({ arena.Create(child_depth, std::move(child), search_node), 0, 0, {}, 0 });
+				}
+			}
+			else
+			{
+				top_node.size_in_tree = TreeUtils::kTerminalSize;
+			}
 		}
-		//Use node to find history hash set number of actions of the info set.
-		std::string history_hash = search_node->HistoryHash();
-		info_set_map.insert({ history_hash, actions.size() });
-
-		
+		//Stop once only terminal nodes are left, keeping them as single node subtrees.
+		if (next_level.empty()) {
+			break;
+		}
+		top_levels.push_back(std::move(next_level));
 	}
-	else if (search_node->IsChanceNode()) {
-		
-		ChanceNode currNode = search_node->GetChanceNode();
-		std::vector<CfrClientNode> children = currNode.Children(static_game_info_);
-		//Add each chance node child to next chance child nodes.
-		curr_node_size = TreeUtils::ChanceNodeSizeInTree(children.size());
-		for (const CfrClientNode& child : children) {
+	return top_levels;
+}
 
-			CfrTreeNode *next_child = new CfrTreeNode(child, search_node);
-			sub_tree_size += ExploreNode(next_child, info_set_map, depth_map_size, curr_depth + 1);
-			delete next_child;
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+SetTopLevels(
+	std::vector<TopLevel>& top_levels,
+	const std::vector<std::vector<long long>>& level_positions,
+	const std::vector<Byte*>& info_set_positions
+) {
+	const int split_depth = static_cast<int>(top_levels.size()) - 1;
+	std::vector<float> child_probs;
+
+	//Terminals above the split depth are built as one more subtree's would be, through the
+	//terminal memo and the UtilityBatch() queue, into a buffer of their own. Their records
+	//are copied to their places in the search tree once every batch is evaluated.
+	SubtreeBuild top_build;
+	top_build.depth_buffers.emplace_back();
+	std::vector<Byte*> top_terminal_positions;
+	for (int depth = 0; depth < split_depth; depth++) {
+		//Children of each level are the next level, in parent order.
+		int child_index = 0;
+		for (int i_node = 0; i_node < static_cast<int>(top_levels[depth].size()); i_node++) {
+			TopNode& top_node = top_levels[depth][i_node];
+			CfrTreeNode* search_node = top_node.node;
+			Byte* curr_offset = game_tree_ + level_positions[depth][i_node];
+			if (search_node->IsPlayerNode()) {
+
+				Byte* child_start_offset = game_tree_ + level_positions[depth + 1][child_index];
+				bool is_player_one = search_node->GetPlayerNode().IsPlayerOne();
+				Byte* info_set_pos = info_set_positions[top_node.info_set_slot];
+				const std::uint32_t children_offset = TreeUtils::CheckedChildrenOffset(child_start_offset - curr_offset);
+				TreeUtils::SetPlayerNode(curr_offset, top_node.num_children, children_offset, is_player_one, info_set_pos);
+			}
+			else if (search_node->IsChanceNode()) {
+
+				Byte* child_start_offset = game_tree_ + level_positions[depth + 1][child_index];
+				const std::uint32_t children_offset = TreeUtils::CheckedChildrenOffset(child_start_offset - curr_offset);
+				//Probabilities are kept by the children, which are the next level's nodes from child_index on.
+				child_probs.clear();
+				for (int i_child = 0; i_child < top_node.num_children; i_child++) {
+					child_probs.push_back(top_levels[depth + 1][child_index + i_child].node->GetProbability());
+				}
+				TreeUtils::SetChanceNode(curr_offset, children_offset, child_probs);
+			}
+			else
+			{
+				std::vector<Byte>& buffer = top_build.depth_buffers[0];
+				const std::size_t node_offset = buffer.size();
+				buffer.resize(node_offset + TreeUtils::TerminalNodeSizeInTree());
+				top_terminal_positions.push_back(curr_offset);
+				BuildTerminal(search_node, 0, node_offset, top_build);
+			}
+			child_index += top_node.num_children;
 		}
 	}
-	else
-	{
-		//Else if terminal, return static terminal node size.
-		curr_node_size = TreeUtils::kTerminalSize;
+	EvaluateTerminals(top_build);
+	for (std::size_t i_terminal = 0; i_terminal < top_terminal_positions.size(); i_terminal++) {
+		Byte* built_pos = top_build.depth_buffers[0].data() + i_terminal * TreeUtils::TerminalNodeSizeInTree();
+		TreeUtils::SetTerminalNode(top_terminal_positions[i_terminal], SearchTreeNode(built_pos).Utility());
 	}
-
-	const long long old_depth_size = depth_map_size.at(curr_depth);
-	depth_map_size[curr_depth] = old_depth_size + curr_node_size;
-
-	return sub_tree_size + curr_node_size;
+	terminal_lookups_ += top_build.terminal_lookups;
+	terminal_memo_hits_ += top_build.terminal_memo_hits;
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
-SetNode(
-	CfrTreeNode* search_node, int depth,
-	std::vector<long long>& cumulative_offsets,
-	InfoSetPositions& info_set_pos_map
-) {
-
-	long long childNodeSize;
-	Byte* curr_offset = game_tree_ + cumulative_offsets[depth];
-	if (search_node->IsPlayerNode()) {
-
-		PlayerNode currNode = search_node->GetPlayerNode();
-		std::vector<Action> actions = currNode.ActionList(static_game_info_);
-		int numChildren = actions.size();
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+BuildSubtree(CfrTreeNode* subtree_root, SubtreeBuild& build) {
 
-		/*Recursive over all children to get child offset*/
-		for (Action a : actions)
-		{
-			CfrTreeNode child = currNode.Child(a, static_game_info_);
-			CfrTreeNode* nextChild = new CfrTreeNode(child, search_node);
-			SetNode(nextChild, depth + 1, cumulative_offsets, info_set_pos_map);
+	WalkStack<BuildFrame> stack;
+	const int root_children = BuildNode(subtree_root, 0, build);
+	if (root_children > 0) {
+		stack.Push(BuildFrame{ subtree_root, 0, root_children, 0, build.node_arena.Mark(1) });
+	}
+	while (!stack.Empty()) {
+		BuildFrame& frame = stack.Top();
+		const int depth = frame.depth;
+		//Each child is destroyed once built, so siblings reuse the same arena slot,
+		//unless a queued terminal still refers to it.
+		if (frame.next_child > 0 && build.pending_terminals.empty()) {
+			build.node_arena.Rewind(depth + 1, frame.child_mark);
 		}
+		if (frame.next_child == frame.num_children) {
+			stack.Pop();
+			continue;
+		}
+		CfrTreeNode* search_node = frame.search_node;
+		CfrTreeNode* child_node = search_node->IsPlayerNode()
+			? build.node_arena.Create(depth + 1,
+				search_node->GetPlayerNode().Child(build.depth_actions[depth][frame.next_child], static_game_info_), search_node)
+			: build.node_arena.Create(depth + 1, std::move(build.depth_children[depth][frame.next_child]), search_node);
+		frame.next_child++;
+		const int num_children = BuildNode(child_node, depth + 1, build);
+		if (num_children > 0) {
+			stack.Push(BuildFrame{ child_node, depth + 1, num_children, 0, build.node_arena.Mark(depth + 2) });
+		}
+	}
+}
 
-		Byte* child_start_offset = cumulative_offsets[depth	+ 1] + game_tree_;
-		bool is_player_one = currNode.IsPlayerOne();
-
-		//Use history hash to find info set position.
-		std::string history_hash = search_node->HistoryHash();
-		Byte* info_set_pos = info_set_pos_map.at(history_hash);
-
-		//Once node is set, it can be safely deleted.
-		delete search_node;
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline int CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+BuildNode(CfrTreeNode* search_node, int depth, SubtreeBuild& build) {
 
-		//Set player node
-		TreeUtils::SetPlayerNode(curr_offset, numChildren, child_start_offset, is_player_one, info_set_pos);
-		childNodeSize =  TreeUtils::kPlayerNodeSize;
+	//Children are appended to the next depth's buffer, so it must exist first.
+	while (static_cast<int>(build.depth_buffers.size()) <= depth + 1) {
+		build.depth_buffers.emplace_back();
+		build.depth_actions.emplace_back();
+		build.depth_children.emplace_back();
 	}
-	else if (search_node->IsChanceNode()) {
-
-		ChanceNode curr_node = search_node->GetChanceNode();
-		std::vector<CfrClientNode> children = curr_node.Children(static_game_info_);
-		std::vector<float> probList = ToFloatList(children);
+	std::vector<Byte>& buffer = build.depth_buffers[depth];
+	const std::size_t node_offset = buffer.size();
+	build.num_nodes++;
+	//Children are placed by their offset in the next depth's buffer until the subtree is placed.
+	const std::uint32_t child_start_offset = TreeUtils::CheckedChildrenOffset(
+		static_cast<long long>(build.depth_buffers[depth + 1].size()));
 
-		for (const CfrClientNode& child : children) {
+	if (search_node->IsPlayerNode()) {
 
-			CfrTreeNode* next_child = new CfrTreeNode(child, search_node);
-			SetNode(next_child, depth + 1, cumulative_offsets, info_set_pos_map);
+		const PlayerNode& curr_node = search_node->GetPlayerNode();
+		std::vector<Action>& actions = build.depth_actions[depth];
+		actions.clear();
+		ActionList(curr_node, actions);
+
+		//Use info set key to find or add the info set of the node.
+		InfoSetKey info_set_key = InfoSetKeyOf(search_node);
+		auto [info_set_index, inserted] = InsertInfoSet(build.info_set_indices, info_set_key,
+			static_cast<long long>(build.info_set_keys.size()));
+		if (inserted) {
+			build.info_set_keys.push_back(info_set_key);
+			build.info_set_num_actions.push_back(static_cast<int>(actions.size()));
 		}
+		CheckInfoSetActions(build.info_set_num_actions[info_set_index], static_cast<int>(actions.size()));
 
-		Byte* child_start_offset = cumulative_offsets[depth	+ 1] + game_tree_;
+		buffer.resize(node_offset + TreeUtils::PlayerNodeSizeInTree(static_cast<int>(actions.size())));
+		TreeUtils::SetPlayerNode(buffer.data() + node_offset, static_cast<int>(actions.size()),
+			child_start_offset, curr_node.IsPlayerOne(),
+			reinterpret_cast<Byte*>(static_cast<std::uintptr_t>(info_set_index)));
+		return static_cast<int>(actions.size());
+	}
+	else if (search_node->IsChanceNode()) {
 
-		//Set chance node in the game tree.
-		TreeUtils::SetChanceNode(curr_offset, child_start_offset, probList);
+		const ChanceNode& curr_node = search_node->GetChanceNode();
+		std::vector<CfrClientNode>& children = build.depth_children[depth];
+		children.clear();
+		ChildList(curr_node, children);
+		ToFloatList(children, build.child_probabilities);
 
-		childNodeSize = TreeUtils::ChanceNodeSizeInTree(children.size());
-		//Once node is set, it can be safely deleted.
-		delete search_node;
+		buffer.resize(node_offset + TreeUtils::ChanceNodeSizeInTree(children.size()));
+		TreeUtils::SetChanceNode(buffer.data() + node_offset, child_start_offset, build.child_probabilities);
+		return static_cast<int>(children.size());
 	}
 	else
 	{
 		//Else set terminal node.
-		HistoryList history_list = search_node->HistoryList();
-		float utility = static_game_info_->UtilityFunc(history_list);
-
-		TreeUtils::SetTerminalNode(curr_offset, utility);
+		buffer.resize(node_offset + TreeUtils::kTerminalSize);
+		BuildTerminal(search_node, depth, node_offset, build);
+		return 0;
+	}
+}
 
-		//Once node is set, it can be safely deleted.
-		delete search_node;
-		childNodeSize = TreeUtils::kTerminalSize;
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+PlaceSubtree(
+	const SubtreeBuild& build, int split_depth,
+	const std::vector<long long>& cumulative_offsets,
+	const std::vector<long long>& info_set_slots,
+	const std::vector<Byte*>& info_set_positions
+) {
+	for (int i_depth = 0; i_depth < static_cast<int>(build.depth_buffers.size()); i_depth++) {
+		const std::vector<Byte>& buffer = build.depth_buffers[i_depth];
+		Byte* curr_offset = game_tree_ + cumulative_offsets[split_depth + i_depth];
+		Byte* depth_end = curr_offset + buffer.size();
+		std::copy(buffer.begin(), buffer.end(), curr_offset);
+
+		while (curr_offset < depth_end) {
+			SearchTreeNode node{ curr_offset };
+			if (!node.IsTerminalNode()) {
+				const long long child_start_offset = TreeUtils::ChildrenOffsetAt(curr_offset);
+				TreeUtils::SetChildrenStart(curr_offset,
+					game_tree_ + cumulative_offsets[split_depth + i_depth + 1] + child_start_offset);
+			}
+			if (node.IsPlayerNode()) {
+				const std::uintptr_t info_set_index = reinterpret_cast<std::uintptr_t>(node.InfoSetPosition());
+				TreeUtils::SetInfoSetPosition(curr_offset, info_set_positions[info_set_slots[info_set_index]]);
+			}
+			curr_offset = node.NextNodePos();
+		}
 	}
-	//Update cumulative offset map.
-	cumulative_offsets[depth] += childNodeSize;
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
 SetInfoSets(
-	InfoSetSizes& info_set_size_map,
-	InfoSetPositions& info_set_pos_map
+	const std::vector<int>& info_set_num_actions, InfoSetLayout info_set_layout,
+	InfoSetPrecision info_set_precision, std::vector<Byte*>& info_set_positions
 ) const
 {
 	Byte* curr_offset = this->regret_table_;
-	for (const auto& [key, val] : info_set_size_map) {
-		info_set_pos_map.insert({ key, curr_offset });
-		curr_offset = TreeUtils::SetInfoSetNode(curr_offset, val);
+	for (const int num_actions : info_set_num_actions) {
+		info_set_positions.push_back(curr_offset);
+		curr_offset = TreeUtils::SetInfoSetNode(curr_offset, num_actions, info_set_layout, info_set_precision);
 	}
 }
 
-
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::InfoSetKey
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+InfoSetKeyOf(CfrTreeNode* search_node)
+{
+	if constexpr (kIntegerInfoSetHash) {
+		return search_node->InfoSetHashValue();
+	}
+	else {
+		return search_node->HistoryHash();
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline std::pair<long long, bool> CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+InsertInfoSet(InfoSetIndex& index, const InfoSetKey& key, long long slot)
+{
+	if constexpr (kIntegerInfoSetHash) {
+		return index.Insert(key, slot);
+	}
+	else {
+		auto [i_info_set, inserted] = index.insert({ key, slot });
+		return { i_info_set->second, inserted };
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+CheckInfoSetActions(int info_set_num_actions, int num_actions)
+{
+	if (info_set_num_actions != num_actions) {
+		throw std::runtime_error("CfrTree::ConstructTree: a node with " + std::to_string(num_actions)
+			+ " actions has the info set of a node with " + std::to_string(info_set_num_actions)
+			+ " actions, from an info set hash collision or inconsistent client hashes");
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline std::uint64_t CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+MixTerminalKey(std::uint64_t key)
+{
+	key = ( key ^ ( key >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	key = ( key ^ ( key >> 27 ) ) * 0x94d049bb133111ebULL;
+	return key ^ ( key >> 31 );
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+ActionList(const PlayerNode& player_node, std::vector<Action>& actions) const
+{
+	if constexpr (CfrConcepts::PlayerNodeActionListIntoFunc<Action, PlayerNode, GameClass>) {
+		player_node.ActionList(static_game_info_, actions);
+	}
+	else {
+		actions = player_node.ActionList(static_game_info_);
+	}
+	//Walks keep the scratch of a node in arrays sized by the bound.
+	if constexpr (kMaxActions > 0) {
+		if (actions.size() > static_cast<std::size_t>(kMaxActions)) {
+			throw std::length_error("Player node has " + std::to_string(actions.size())
+				+ " actions, more than the game's kMaxActions of " + std::to_string(kMaxActions));
+		}
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+ChildList(const ChanceNode& chance_node, std::vector<CfrClientNode>& children) const
+{
+	if constexpr (CfrConcepts::ChanceNodeChildrenIntoFunc<Action, PlayerNode, ChanceNode, GameClass>) {
+		chance_node.Children(static_game_info_, children);
+	}
+	else {
+		children = chance_node.Children(static_game_info_);
+	}
+	if constexpr (kMaxChanceChildren > 0) {
+		if (children.size() > static_cast<std::size_t>(kMaxChanceChildren)) {
+			throw std::length_error("Chance node has " + std::to_string(children.size())
+				+ " children, more than the game's kMaxChanceChildren of " + std::to_string(kMaxChanceChildren));
+		}
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline float CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+TerminalUtility(CfrTreeNode* search_node, std::vector<const CfrTreeNode*>& history_path) const
+{
+	if constexpr (CfrConcepts::UtilityViewFunc<Action, PlayerNode, ChanceNode, GameClass>) {
+		search_node->HistoryPath(history_path);
+		return static_game_info_->UtilityFunc(CfrHistoryView(history_path));
+	}
+	else if constexpr (CfrConcepts::UtilityListFunc<Action, PlayerNode, ChanceNode, GameClass>) {
+		return static_game_info_->UtilityFunc(search_node->HistoryList());
+	}
+	else {
+		search_node->HistoryPath(history_path);
+		const CfrHistoryView history(history_path);
+		float utility = 0.0f;
+		static_game_info_->UtilityBatch(std::span<const CfrHistoryView>(&history, 1), std::span<float>(&utility, 1));
+		return utility;
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+BuildTerminal(CfrTreeNode* search_node, int depth, std::size_t node_offset, SubtreeBuild& build) const
+{
+	Byte* node_pos = build.depth_buffers[depth].data() + node_offset;
+	[[maybe_unused]] long long memo_slot = -1;
+	if constexpr (kTerminalMemo) {
+		search_node->HistoryPath(build.history_path);
+		const std::uint64_t terminal_key = static_game_info_->TerminalKey(CfrHistoryView(build.history_path));
+
+		//Keys are mixed bijectively, so distinct keys stay distinct while small or
+		//sequential client keys still spread over the index's buckets.
+		auto [slot, inserted] = build.terminal_memo.Insert(MixTerminalKey(terminal_key),
+			static_cast<long long>(build.memo_utilities.size()));
+		build.terminal_lookups++;
+		if (!inserted) {
+			build.terminal_memo_hits++;
+			if (slot < build.memo_ready_slots) {
+				TreeUtils::SetTerminalNode(node_pos, build.memo_utilities[slot]);
+			}
+			else {
+				//Same key as a queued terminal, so set once its batch is evaluated.
+				TreeUtils::SetTerminalNode(node_pos, 0.0f);
+				build.pending_copies.push_back({ depth, node_offset, 0, 0, slot });
+			}
+			return;
+		}
+		build.memo_utilities.push_back(0.0f);
+		memo_slot = slot;
+	}
+
+	if constexpr (kBatchedUtility) {
+		//Utility is set once the terminal's batch is evaluated.
+		TreeUtils::SetTerminalNode(node_pos, 0.0f);
+		if constexpr (!kTerminalMemo) {
+			search_node->HistoryPath(build.history_path);
+		}
+		QueueTerminal(depth, node_offset, memo_slot, build);
+	}
+	else {
+		const float utility = TerminalUtility(search_node, build.history_path);
+		TreeUtils::SetTerminalNode(node_pos, utility);
+		if constexpr (kTerminalMemo) {
+			build.memo_utilities[memo_slot] = utility;
+			build.memo_ready_slots = static_cast<long long>(build.memo_utilities.size());
+		}
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+QueueTerminal(int depth, std::size_t node_offset, long long memo_slot, SubtreeBuild& build) const
+{
+	build.pending_terminals.push_back({ depth, node_offset, build.pending_paths.size(), build.history_path.size(), memo_slot });
+	build.pending_paths.insert(build.pending_paths.end(), build.history_path.begin(), build.history_path.end());
+	if (static_cast<int>(build.pending_terminals.size()) >= kUtilityBatchSize) {
+		EvaluateTerminals(build);
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+EvaluateTerminals(SubtreeBuild& build) const
+{
+	if constexpr (kBatchedUtility) {
+		if (build.pending_terminals.empty()) {
+			return;
+		}
+		//Views are made once the queue is full, as pending paths move while they grow.
+		build.pending_views.clear();
+		for (const PendingTerminal& terminal : build.pending_terminals) {
+			build.pending_views.emplace_back(build.pending_paths.data() + terminal.path_start, terminal.path_size);
+		}
+		build.pending_utilities.assign(build.pending_terminals.size(), 0.0f);
+		static_game_info_->UtilityBatch(
+			std::span<const CfrHistoryView>(build.pending_views), std::span<float>(build.pending_utilities));
+
+		for (std::size_t i_terminal = 0; i_terminal < build.pending_terminals.size(); i_terminal++) {
+			const PendingTerminal& terminal = build.pending_terminals[i_terminal];
+			TreeUtils::SetTerminalNode(build.depth_buffers[terminal.depth].data() + terminal.node_offset,
+				build.pending_utilities[i_terminal]);
+			if constexpr (kTerminalMemo) {
+				build.memo_utilities[terminal.memo_slot] = build.pending_utilities[i_terminal];
+			}
+		}
+		if constexpr (kTerminalMemo) {
+			for (const PendingTerminal& copy : build.pending_copies) {
+				TreeUtils::SetTerminalNode(build.depth_buffers[copy.depth].data() + copy.node_offset,
+					build.memo_utilities[copy.memo_slot]);
+			}
+			build.pending_copies.clear();
+			build.memo_ready_slots = static_cast<long long>(build.memo_utilities.size());
+		}
+		build.pending_terminals.clear();
+		build.pending_paths.clear();
+	}
+}
+
+
 /*
 ############################################
 ## Counter Factual Regret Solver Methods  ##
 ############################################
 */
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline float CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<bool kIsPlayerOne, bool kSharedTable, bool kSampled>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::WalkValue
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
 WalkTree(
-	SearchTreeNode& node, bool is_player_one, int iteration,
-	float player_one_reach_prob, float player_two_reach_prob, bool with_sampling
+	SearchTreeNode& node,
+	WalkValue player_one_reach_prob, WalkValue player_two_reach_prob,
+	PrefetchOptions prefetch, std::mt19937* rng
 ) {
 	
 	if (node.IsTerminalNode()) {
-		return node.Utility();
+		return UpdatedPlayerUtility(node.Utility(), kIsPlayerOne);
 	}
 	else if (node.IsChanceNode()) {
 
-		if (with_sampling)
+		if constexpr (kSampled)
 		{
-			SearchTreeNode child = node.SampleChild();
-			return WalkTree(child, is_player_one, iteration, player_one_reach_prob, player_two_reach_prob, with_sampling);
+			SearchTreeNode child = rng == nullptr ? node.SampleChild()
+				: node.SampleChild(std::uniform_real_distribution<float>{ 0.0f, 1.0f }(*rng));
+			return WalkTree<kIsPlayerOne, kSharedTable, kSampled>(child, player_one_reach_prob, player_two_reach_prob, prefetch, rng);
 		}
-		float val = 0;
-		int child_index = 0;
-		const std::vector<float> child_probabilities = node.ChildProbabilities();
-		std::vector<SearchTreeNode> children = node.AllChildren();
-		for (SearchTreeNode& child : children) {
-			const float child_util = WalkTree(child, is_player_one, iteration, player_one_reach_prob, player_two_reach_prob, with_sampling);
-			const float child_reach_prob = child_probabilities[child_index];
-			val += child_reach_prob * child_util;
-			child_index++;
-		}
-		return val;
-	}
-	else {
-		float val = 0;
-		const int num_children = node.NumChildren();
-		std::vector<SearchTreeNode> children = node.AllChildren();
-		std::vector<float> child_utilities(num_children, 0);
-		InfoSetData info_set = InfoSetData(node.InfoSetPosition());
-		for (int i_action = 0; i_action < num_children; i_action++)
+		else
 		{
-			float curr_strat_prob = info_set.GetCurrentStrategy(i_action);
-			float child_utility;
-			if (node.IsPlayerOne())
-			{
-				child_utility = WalkTree(children.at(i_action), is_player_one,
-				                        iteration, curr_strat_prob * player_one_reach_prob,
-				                        player_two_reach_prob, with_sampling);
+			WalkValue val = 0;
+			int child_index = 0;
+			const std::span<const float> child_probabilities = node.ChildProbabilitySpan();
+			ChildPrefetcher prefetcher{ node, prefetch };
+			for (SearchTreeNode child : node.Children()) {
+				prefetcher.Advance();
+				const WalkValue child_util = WalkTree<kIsPlayerOne, kSharedTable, kSampled>(child, player_one_reach_prob, player_two_reach_prob, prefetch, rng);
+				const WalkValue child_reach_prob = child_probabilities[child_index];
+				val += child_reach_prob * child_util;
+				child_index++;
 			}
-			else
-			{
-				child_utility = WalkTree(children.at(i_action), is_player_one,
-				                        iteration, player_one_reach_prob,
-				                        curr_strat_prob * player_two_reach_prob, with_sampling);
+			return val;
+		}
+	}
+	else if (node.IsPlayerOne()) {
+		return WalkTreePlayer<kIsPlayerOne, kSharedTable, kSampled, true>(node,
+			player_one_reach_prob, player_two_reach_prob, prefetch, rng);
+	}
+	return WalkTreePlayer<kIsPlayerOne, kSharedTable, kSampled, false>(node,
+		player_one_reach_prob, player_two_reach_prob, prefetch, rng);
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<bool kIsPlayerOne, bool kSharedTable, bool kSampled, bool kActingPlayerOne>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::WalkValue
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkTreePlayer(
+	SearchTreeNode& node,
+	WalkValue player_one_reach_prob, WalkValue player_two_reach_prob,
+	PrefetchOptions prefetch, std::mt19937* rng
+) {
+
+	WalkValue val = 0;
+	ActionValues child_utilities(node.NumChildren());
+	InfoSetData info_set = InfoSetData(node.InfoSetPosition());
+	ActionValues strategy_scratch(info_set.StoresCurrentStrategy() && !kSharedTable ? 0 : node.NumChildren());
+	const float* current_strategy = WalkStrategy(info_set, strategy_scratch.data(), kSharedTable);
+	const WalkValue acting_reach_prob = kActingPlayerOne ? player_one_reach_prob : player_two_reach_prob;
+	ChildPrefetcher prefetcher{ node, prefetch };
+	int i_action = 0;
+	for (SearchTreeNode child : node.Children())
+	{
+		prefetcher.Advance();
+		const WalkValue curr_strat_prob = current_strategy[i_action];
+		const WalkValue child_reach_prob = curr_strat_prob * acting_reach_prob;
+		const WalkValue child_utility = WalkTree<kIsPlayerOne, kSharedTable, kSampled>(child,
+			kActingPlayerOne ? child_reach_prob : player_one_reach_prob,
+			kActingPlayerOne ? player_two_reach_prob : child_reach_prob, prefetch, rng);
+		child_utilities[i_action] = static_cast<float>(child_utility);
+		val += curr_strat_prob * child_utility;
+		i_action++;
+	}
+	if constexpr (kActingPlayerOne == kIsPlayerOne)
+	{
+		const WalkValue regret_prob = kIsPlayerOne ? player_two_reach_prob : player_one_reach_prob;
+		AccumulateRegrets(info_set, current_strategy, child_utilities.data(), static_cast<float>(val),
+			static_cast<float>(regret_prob), static_cast<float>(acting_reach_prob), kSharedTable);
+		if constexpr (kMatchPerVisit) {
+			RegretMatching(info_set, kSharedTable);
+		}
+	}
+	return val;
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<bool kIsPlayerOne, bool kSharedTable, bool kSampled>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::WalkValue
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkTreeIterative(
+	const SearchTreeNode& root,
+	PrefetchOptions prefetch, std::mt19937* rng
+) {
+
+	thread_local WalkStack<CfrWalkFrame> stack;
+	stack.Clear();
+	SearchTreeNode node = root;
+	//A sampled chance node takes the value of its sampled child, so the child is walked in its place.
+	while (kSampled && node.IsChanceNode()) {
+		node = rng == nullptr ? node.SampleChild()
+			: node.SampleChild(std::uniform_real_distribution<float>{ 0.0f, 1.0f }(*rng));
+	}
+	if (node.IsTerminalNode()) {
+		return UpdatedPlayerUtility(node.Utility(), kIsPlayerOne);
+	}
+	WalkValue player_one_reach_prob = 1;
+	WalkValue player_two_reach_prob = 1;
+	while (true) {
+
+		CfrWalkFrame& pushed = stack.Push(node, prefetch, player_one_reach_prob, player_two_reach_prob);
+		if (pushed.is_player_node) {
+			//Child utilities, followed by scratch for a current strategy the info set derives.
+			pushed.values_offset = stack.PushValues(2 * pushed.num_children);
+			InfoSetData info_set = InfoSetData(pushed.info_set_position);
+			pushed.child_weights = kSharedTable ? nullptr : info_set.CurrentStrategyData();
+			if (pushed.child_weights == nullptr) {
+				WalkStrategy(info_set, stack.Values(pushed.values_offset + pushed.num_children), kSharedTable);
 			}
-			child_utilities.at(i_action) = child_utility;
-			val += curr_strat_prob * child_utility;
 		}
-		if (node.IsPlayerOne() == is_player_one)
-		{
-			float regret_prob;
-			float strat_prob;
-			if (is_player_one)
-			{
-				regret_prob = player_two_reach_prob;
-				strat_prob = player_one_reach_prob;
+
+		//Finishes the frames whose children are all walked and adds terminal children to their
+		//parent in place, until the next child to walk is found.
+		while (true) {
+			CfrWalkFrame& frame = stack.Top();
+			if (frame.child_index == frame.num_children) {
+				if (frame.is_player_node) {
+					if (frame.is_player_one == kIsPlayerOne) {
+						InfoSetData info_set = InfoSetData(frame.info_set_position);
+						const WalkValue regret_prob = kIsPlayerOne ? frame.player_two_reach_prob : frame.player_one_reach_prob;
+						const WalkValue strat_prob = kIsPlayerOne ? frame.player_one_reach_prob : frame.player_two_reach_prob;
+						AccumulateRegrets(info_set, ChildWeights(stack, frame), stack.Values(frame.values_offset),
+							static_cast<float>(frame.val), static_cast<float>(regret_prob), static_cast<float>(strat_prob),
+							kSharedTable);
+						if constexpr (kMatchPerVisit) {
+							RegretMatching(info_set, kSharedTable);
+						}
+					}
+					stack.PopValues(2 * frame.num_children);
+				}
+				const WalkValue value = frame.val;
+				stack.Pop();
+				if (stack.Empty()) {
+					return value;
+				}
+				AddChildValue(stack, stack.Top(), value);
+				continue;
 			}
-			else 
-			{
-				regret_prob = player_one_reach_prob;
-				strat_prob = player_two_reach_prob;
+			frame.prefetcher.Advance();
+			node = SearchTreeNode{ frame.next_child };
+			frame.next_child += TreeUtils::NodeSizeAt(frame.next_child);
+			frame.child_strat_prob = ChildWeights(stack, frame)[frame.child_index];
+			while (kSampled && node.IsChanceNode()) {
+				node = rng == nullptr ? node.SampleChild()
+					: node.SampleChild(std::uniform_real_distribution<float>{ 0.0f, 1.0f }(*rng));
 			}
-			for (int i_action = 0; i_action < num_children; i_action++)
-			{
-				info_set.AddToCumulativeRegret(regret_prob * (child_utilities.at(i_action) - val), i_action);
-				info_set.AddToCumulativeStrategy(strat_prob * info_set.GetCurrentStrategy(i_action), i_action);
+			if (!node.IsTerminalNode()) {
+				break;
+			}
+			AddChildValue(stack, frame, UpdatedPlayerUtility(node.Utility(), kIsPlayerOne));
+		}
+
+		const CfrWalkFrame& parent = stack.Top();
+		player_one_reach_prob = parent.player_one_reach_prob;
+		player_two_reach_prob = parent.player_two_reach_prob;
+		if (parent.is_player_node) {
+			if (parent.is_player_one) {
+				player_one_reach_prob = parent.child_strat_prob * parent.player_one_reach_prob;
+			}
+			else {
+				player_two_reach_prob = parent.child_strat_prob * parent.player_two_reach_prob;
 			}
-			RegretMatching(info_set);
 		}
-		return val;
 	}
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
-RegretMatching(InfoSetData& info_set) {
-	float regret_sum = 0;
-	for (int i_action = 0; i_action < info_set.NumActions(); i_action++) 
-	{
-		float action_regret = info_set.GetCumulativeRegret(i_action);
-		if (action_regret > 0)
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<typename Frame>
+inline const float* CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+ChildWeights(WalkStack<Frame>& stack, const Frame& frame) {
+	return frame.child_weights != nullptr ? frame.child_weights
+		: stack.Values(frame.values_offset + frame.num_children);
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<typename Frame>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+AddChildValue(WalkStack<Frame>& stack, Frame& parent, WalkValue child_value) {
+	if (parent.is_player_node) {
+		stack.Values(parent.values_offset)[parent.child_index] = static_cast<float>(child_value);
+	}
+	parent.val += parent.child_strat_prob * child_value;
+	parent.child_index++;
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<bool kIsPlayerOne, bool kSharedTable, bool kSampled>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::WalkValue
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkPools(
+	const NodePools& pools, NodePools::NodeRef node,
+	WalkValue player_one_reach_prob, WalkValue player_two_reach_prob,
+	PrefetchOptions prefetch, std::mt19937* rng
+) {
+
+	const std::uint32_t index = NodePools::Index(node);
+	if (NodePools::Type(node) == NodePools::kTerminal) {
+		return UpdatedPlayerUtility(pools.Utility(index), kIsPlayerOne);
+	}
+	else if (NodePools::Type(node) == NodePools::kChance) {
+
+		if constexpr (kSampled)
 		{
-			info_set.SetCurrentStrategy(action_regret, i_action);
-			regret_sum += action_regret;
+			return WalkPools<kIsPlayerOne, kSharedTable, kSampled>(pools, SampledChanceChild(pools, index, rng),
+				player_one_reach_prob, player_two_reach_prob, prefetch, rng);
 		}
 		else
 		{
-			info_set.SetCurrentStrategy(0.0, i_action);
+			WalkValue val = 0;
+			const int num_children = pools.ChanceNumChildren(index);
+			for (int i_ahead = 0; i_ahead < std::min(prefetch.distance, num_children); i_ahead++) {
+				pools.Prefetch(pools.ChanceChild(index, i_ahead), prefetch);
+			}
+			for (int i_child = 0; i_child < num_children; i_child++) {
+				if (prefetch.distance > 0 && i_child + prefetch.distance < num_children) {
+					pools.Prefetch(pools.ChanceChild(index, i_child + prefetch.distance), prefetch);
+				}
+				const WalkValue child_util = WalkPools<kIsPlayerOne, kSharedTable, kSampled>(pools, pools.ChanceChild(index, i_child),
+					player_one_reach_prob, player_two_reach_prob, prefetch, rng);
+				val += static_cast<WalkValue>(pools.ChildProbability(index, i_child)) * child_util;
+			}
+			return val;
 		}
 	}
-	const float uniform_prob = 1.0 / static_cast<float>(info_set.NumActions());
-	for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
+	else if (pools.IsPlayerOne(index)) {
+		return WalkPoolsPlayer<kIsPlayerOne, kSharedTable, kSampled, true>(pools, index,
+			player_one_reach_prob, player_two_reach_prob, prefetch, rng);
+	}
+	return WalkPoolsPlayer<kIsPlayerOne, kSharedTable, kSampled, false>(pools, index,
+		player_one_reach_prob, player_two_reach_prob, prefetch, rng);
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<bool kIsPlayerOne, bool kSharedTable, bool kSampled, bool kActingPlayerOne>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::WalkValue
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkPoolsPlayer(
+	const NodePools& pools, std::uint32_t index,
+	WalkValue player_one_reach_prob, WalkValue player_two_reach_prob,
+	PrefetchOptions prefetch, std::mt19937* rng
+) {
+
+	WalkValue val = 0;
+	const int num_children = pools.PlayerNumChildren(index);
+	ActionValues child_utilities(num_children);
+	InfoSetData info_set = InfoSetData(pools.InfoSetPosition(index));
+	ActionValues strategy_scratch(info_set.StoresCurrentStrategy() && !kSharedTable ? 0 : num_children);
+	const float* current_strategy = WalkStrategy(info_set, strategy_scratch.data(), kSharedTable);
+	const WalkValue acting_reach_prob = kActingPlayerOne ? player_one_reach_prob : player_two_reach_prob;
+	for (int i_ahead = 0; i_ahead < std::min(prefetch.distance, num_children); i_ahead++) {
+		pools.Prefetch(pools.PlayerChild(index, i_ahead), prefetch);
+	}
+	for (int i_action = 0; i_action < num_children; i_action++)
+	{
+		if (prefetch.distance > 0 && i_action + prefetch.distance < num_children) {
+			pools.Prefetch(pools.PlayerChild(index, i_action + prefetch.distance), prefetch);
+		}
+		const WalkValue curr_strat_prob = current_strategy[i_action];
+		const WalkValue child_reach_prob = curr_strat_prob * acting_reach_prob;
+		const WalkValue child_utility = WalkPools<kIsPlayerOne, kSharedTable, kSampled>(pools, pools.PlayerChild(index, i_action),
+			kActingPlayerOne ? child_reach_prob : player_one_reach_prob,
+			kActingPlayerOne ? player_two_reach_prob : child_reach_prob, prefetch, rng);
+		child_utilities[i_action] = static_cast<float>(child_utility);
+		val += curr_strat_prob * child_utility;
+	}
+	if constexpr (kActingPlayerOne == kIsPlayerOne)
+	{
+		const WalkValue regret_prob = kIsPlayerOne ? player_two_reach_prob : player_one_reach_prob;
+		AccumulateRegrets(info_set, current_strategy, child_utilities.data(), static_cast<float>(val),
+			static_cast<float>(regret_prob), static_cast<float>(acting_reach_prob), kSharedTable);
+		if constexpr (kMatchPerVisit) {
+			RegretMatching(info_set, kSharedTable);
+		}
+	}
+	return val;
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<bool kIsPlayerOne, bool kSharedTable, bool kSampled>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::WalkValue
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkPoolsIterative(const NodePools& pools, PrefetchOptions prefetch, std::mt19937* rng) {
+
+	thread_local WalkStack<PoolsWalkFrame> stack;
+	stack.Clear();
+	NodePools::NodeRef node = pools.Root();
+	while (kSampled && NodePools::Type(node) == NodePools::kChance) {
+		node = SampledChanceChild(pools, NodePools::Index(node), rng);
+	}
+	if (NodePools::Type(node) == NodePools::kTerminal) {
+		return UpdatedPlayerUtility(pools.Utility(NodePools::Index(node)), kIsPlayerOne);
+	}
+	WalkValue player_one_reach_prob = 1;
+	WalkValue player_two_reach_prob = 1;
+	auto child_of = [&pools](const PoolsWalkFrame& frame, int i_child) {
+		return frame.is_player_node ? pools.PlayerChild(frame.index, i_child) : pools.ChanceChild(frame.index, i_child);
+	};
+	while (true) {
+
+		PoolsWalkFrame& pushed = stack.Push(pools, node, player_one_reach_prob, player_two_reach_prob);
+		for (int i_ahead = 0; i_ahead < std::min(prefetch.distance, pushed.num_children); i_ahead++) {
+			pools.Prefetch(child_of(pushed, i_ahead), prefetch);
+		}
+		if (pushed.is_player_node) {
+			//Child utilities, followed by scratch for a current strategy the info set derives.
+			pushed.values_offset = stack.PushValues(2 * pushed.num_children);
+			InfoSetData info_set = InfoSetData(pools.InfoSetPosition(pushed.index));
+			pushed.child_weights = kSharedTable ? nullptr : info_set.CurrentStrategyData();
+			if (pushed.child_weights == nullptr) {
+				WalkStrategy(info_set, stack.Values(pushed.values_offset + pushed.num_children), kSharedTable);
+			}
+		}
+
+		//Finishes the frames whose children are all walked and adds terminal children to their
+		//parent in place, until the next child to walk is found.
+		while (true) {
+			PoolsWalkFrame& frame = stack.Top();
+			if (frame.child_index == frame.num_children) {
+				if (frame.is_player_node) {
+					if (frame.is_player_one == kIsPlayerOne) {
+						InfoSetData info_set = InfoSetData(pools.InfoSetPosition(frame.index));
+						const WalkValue regret_prob = kIsPlayerOne ? frame.player_two_reach_prob : frame.player_one_reach_prob;
+						const WalkValue strat_prob = kIsPlayerOne ? frame.player_one_reach_prob : frame.player_two_reach_prob;
+						AccumulateRegrets(info_set, ChildWeights(stack, frame), stack.Values(frame.values_offset),
+							static_cast<float>(frame.val), static_cast<float>(regret_prob), static_cast<float>(strat_prob),
+							kSharedTable);
+						if constexpr (kMatchPerVisit) {
+							RegretMatching(info_set, kSharedTable);
+						}
+					}
+					stack.PopValues(2 * frame.num_children);
+				}
+				const WalkValue value = frame.val;
+				stack.Pop();
+				if (stack.Empty()) {
+					return value;
+				}
+				AddChildValue(stack, stack.Top(), value);
+				continue;
+			}
+			if (prefetch.distance > 0 && frame.child_index + prefetch.distance < frame.num_children) {
+				pools.Prefetch(child_of(frame, frame.child_index + prefetch.distance), prefetch);
+			}
+			node = child_of(frame, frame.child_index);
+			frame.child_strat_prob = ChildWeights(stack, frame)[frame.child_index];
+			while (kSampled && NodePools::Type(node) == NodePools::kChance) {
+				node = SampledChanceChild(pools, NodePools::Index(node), rng);
+			}
+			if (NodePools::Type(node) != NodePools::kTerminal) {
+				break;
+			}
+			AddChildValue(stack, frame, UpdatedPlayerUtility(pools.Utility(NodePools::Index(node)), kIsPlayerOne));
+		}
+
+		const PoolsWalkFrame& parent = stack.Top();
+		player_one_reach_prob = parent.player_one_reach_prob;
+		player_two_reach_prob = parent.player_two_reach_prob;
+		if (parent.is_player_node) {
+			if (parent.is_player_one) {
+				player_one_reach_prob = parent.child_strat_prob * parent.player_one_reach_prob;
+			}
+			else {
+				player_two_reach_prob = parent.child_strat_prob * parent.player_two_reach_prob;
+			}
+		}
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline NodePools::NodeRef CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+SampledChanceChild(const NodePools& pools, std::uint32_t index, std::mt19937* rng) {
+	const float rand_float = rng == nullptr
+		? static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX)
+		: std::uniform_real_distribution<float>{ 0.0f, 1.0f }(*rng);
+	return pools.ChanceChild(index, SampleChanceChild(pools, index, rand_float));
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline int CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+SampleChanceChild(const NodePools& pools, std::uint32_t index, float rand_float) {
+
+	if constexpr (kUnrolledChance) {
+		//Cumulative probabilities only grow, so the sampled child is the number of them rand_float passed.
+		const int num_children = pools.ChanceNumChildren(index);
+		float cumulative_prob = 0;
+		int sampled_child = 0;
+		for (int i_child = 0; i_child < kMaxChanceChildren - 1; i_child++) {
+			const bool in_range = i_child < num_children - 1;
+			cumulative_prob += in_range ? pools.ChildProbability(index, i_child) : 0.0f;
+			sampled_child += in_range && rand_float >= cumulative_prob;
+		}
+		return sampled_child;
+	}
+	else {
+		return pools.SampleChild(index, rand_float);
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline float CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkRoot(bool is_player_one, bool with_sampling, std::mt19937* rng, bool shared_table) {
+
+	if (shared_table) {
+		return SamplesChance(with_sampling) ? WalkRootOf<true, true>(is_player_one, rng)
+			: WalkRootOf<true, false>(is_player_one, rng);
+	}
+	return SamplesChance(with_sampling) ? WalkRootOf<false, true>(is_player_one, rng)
+		: WalkRootOf<false, false>(is_player_one, rng);
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkFullIteration() {
+	static_assert(kMatchPerVisit || Policy::kSampling != CfrSampling::kChanceSampled,
+		"CfrMatchTiming::kPerPass would rematch the whole regret table after every sampled walk");
+	for (const bool is_player_one : { true, false }) {
+		WalkRoot(is_player_one, false);
+		if constexpr (!kMatchPerVisit) {
+			MatchRegretTable(false);
+		}
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<bool kSharedTable, bool kSampled>
+inline float CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkRootOf(bool is_player_one, std::mt19937* rng) {
+
+	if (!node_pools_.Empty() && iterative_walks_) {
+		return static_cast<float>(is_player_one
+			? WalkPoolsIterative<true, kSharedTable, kSampled>(node_pools_, prefetch_, rng)
+			: WalkPoolsIterative<false, kSharedTable, kSampled>(node_pools_, prefetch_, rng));
+	}
+	if (!node_pools_.Empty()) {
+		return static_cast<float>(is_player_one
+			? WalkPools<true, kSharedTable, kSampled>(node_pools_, node_pools_.Root(), 1, 1, prefetch_, rng)
+			: WalkPools<false, kSharedTable, kSampled>(node_pools_, node_pools_.Root(), 1, 1, prefetch_, rng));
+	}
+	SearchTreeNode root_chance = SearchTreeNode(game_tree_);
+	if (iterative_walks_) {
+		return static_cast<float>(is_player_one
+			? WalkTreeIterative<true, kSharedTable, kSampled>(root_chance, prefetch_, rng)
+			: WalkTreeIterative<false, kSharedTable, kSampled>(root_chance, prefetch_, rng));
+	}
+	return static_cast<float>(is_player_one
+		? WalkTree<true, kSharedTable, kSampled>(root_chance, 1, 1, prefetch_, rng)
+		: WalkTree<false, kSharedTable, kSampled>(root_chance, 1, 1, prefetch_, rng));
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkSampledTrees(CfrThreadPool& pool, int first_iteration, int iterations) {
+	//One chunk per thread, so each thread seeds a single generator.
+	const long long grain_size = ( iterations + pool.NumThreads() - 1 ) / pool.NumThreads();
+	const unsigned base_seed = static_cast<unsigned>(std::rand());
+	pool.ParallelFor(first_iteration, first_iteration + iterations, grain_size,
+		[&](long long i_begin, long long i_end) {
+		std::seed_seq seed{ base_seed, static_cast<unsigned>(i_begin) };
+		std::mt19937 rng{ seed };
+		for (long long i_cfr = i_begin; i_cfr < i_end; i_cfr++) {
+
+			WalkRoot(true, true, &rng, true);
+			WalkRoot(false, true, &rng, true);
+		}
+	});
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::WalkValue
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkLevels(
+	const TreeLevelIndex& levels, CfrThreadPool& pool, bool is_player_one,
+	std::vector<WalkValue>& player_one_reach, std::vector<WalkValue>& player_two_reach,
+	std::vector<WalkValue>& node_values
+) {
+
+	//Top down: push reach probabilities through each depth using the current strategies.
+	player_one_reach[0] = 1;
+	player_two_reach[0] = 1;
+	for (int depth = 0; depth < levels.NumLevels() - 1; depth++) {
+		pool.ParallelFor(levels.LevelStart(depth), levels.LevelEnd(depth), kLevelGrainSize,
+			[&](long long i_begin, long long i_end) {
+			for (long long i_node = i_begin; i_node < i_end; i_node++) {
+				const SearchTreeNode node{ levels.NodePosition(i_node) };
+				if (node.IsTerminalNode()) {
+					continue;
+				}
+				const long long first_child = levels.FirstChild(i_node);
+				if (node.IsChanceNode()) {
+					for (int i_child = 0; i_child < node.NumChildren(); i_child++) {
+						player_one_reach[first_child + i_child] = player_one_reach[i_node];
+						player_two_reach[first_child + i_child] = player_two_reach[i_node];
+					}
+					continue;
+				}
+				InfoSetData info_set = InfoSetData(node.InfoSetPosition());
+				ActionValues strategy_scratch(info_set.StoresCurrentStrategy() ? 0 : node.NumChildren());
+				const float* current_strategy = info_set.CurrentStrategy(strategy_scratch.data());
+				for (int i_action = 0; i_action < node.NumChildren(); i_action++) {
+					const WalkValue curr_strat_prob = current_strategy[i_action];
+					if (node.IsPlayerOne())
+					{
+						player_one_reach[first_child + i_action] = curr_strat_prob * player_one_reach[i_node];
+						player_two_reach[first_child + i_action] = player_two_reach[i_node];
+					}
+					else
+					{
+						player_one_reach[first_child + i_action] = player_one_reach[i_node];
+						player_two_reach[first_child + i_action] = curr_strat_prob * player_two_reach[i_node];
+					}
+				}
+			}
+		});
+	}
+
+	//Bottom up: reduce child values into their parents, deepest level first.
+	for (int depth = levels.NumLevels() - 1; depth >= 0; depth--) {
+		pool.ParallelFor(levels.LevelStart(depth), levels.LevelEnd(depth), kLevelGrainSize,
+			[&](long long i_begin, long long i_end) {
+			for (long long i_node = i_begin; i_node < i_end; i_node++) {
+				const SearchTreeNode node{ levels.NodePosition(i_node) };
+				if (node.IsTerminalNode()) {
+					node_values[i_node] = UpdatedPlayerUtility(node.Utility(), is_player_one);
+					continue;
+				}
+				const long long first_child = levels.FirstChild(i_node);
+				WalkValue val = 0;
+				if (node.IsChanceNode()) {
+					for (int i_child = 0; i_child < node.NumChildren(); i_child++) {
+						val += static_cast<WalkValue>(node.ChildProbability(i_child)) * node_values[first_child + i_child];
+					}
+				}
+				else {
+					InfoSetData info_set = InfoSetData(node.InfoSetPosition());
+					ActionValues strategy_scratch(info_set.StoresCurrentStrategy() ? 0 : node.NumChildren());
+					const float* current_strategy = info_set.CurrentStrategy(strategy_scratch.data());
+					for (int i_action = 0; i_action < node.NumChildren(); i_action++) {
+						val += static_cast<WalkValue>(current_strategy[i_action]) * node_values[first_child + i_action];
+					}
+				}
+				node_values[i_node] = val;
+			}
+		});
+	}
+
+	//Apply regrets per info set, so no two threads update the same info set.
+	pool.ParallelFor(0, levels.NumInfoSets(), kLevelGrainSize / 4,
+		[&](long long i_begin, long long i_end) {
+		for (long long i_info_set = i_begin; i_info_set < i_end; i_info_set++) {
+			const long long nodes_start = levels.InfoSetNodesStart(i_info_set);
+			if (SearchTreeNode{ levels.NodePosition(levels.InfoSetNode(nodes_start)) }.IsPlayerOne() != is_player_one) {
+				continue;
+			}
+			InfoSetData info_set = InfoSetData(levels.InfoSetPosition(i_info_set));
+			//Every visit accumulates with the strategy of this iteration, derived before any regret changes.
+			ActionValues strategy_scratch(info_set.StoresCurrentStrategy() ? 0 : info_set.NumActions());
+			const float* current_strategy = info_set.CurrentStrategy(strategy_scratch.data());
+			ActionValues child_utilities(info_set.NumActions());
+			for (long long i_entry = nodes_start; i_entry < levels.InfoSetNodesEnd(i_info_set); i_entry++) {
+				const long long i_node = levels.InfoSetNode(i_entry);
+				const long long first_child = levels.FirstChild(i_node);
+				const WalkValue regret_prob = is_player_one ? player_two_reach[i_node] : player_one_reach[i_node];
+				const WalkValue strat_prob = is_player_one ? player_one_reach[i_node] : player_two_reach[i_node];
+				for (int i_action = 0; i_action < info_set.NumActions(); i_action++) {
+					child_utilities[i_action] = static_cast<float>(node_values[first_child + i_action]);
+				}
+				AccumulateRegrets(info_set, current_strategy, child_utilities.data(), static_cast<float>(node_values[i_node]),
+					static_cast<float>(regret_prob), static_cast<float>(strat_prob), false);
+			}
+			//Each info set is updated by a single thread, and read only in the other passes.
+			RegretMatching(info_set, false);
+		}
+	});
+	return node_values[0];
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline typename CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::WalkValue
+CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+WalkTreeTasks(
+	const TreeLevelIndex& levels, CfrThreadPool& pool, std::vector<std::mutex>& info_set_locks,
+	long long node_index, bool is_player_one,
+	WalkValue player_one_reach_prob, WalkValue player_two_reach_prob, long long grain_size
+) {
+
+	const SearchTreeNode node{ levels.NodePosition(node_index) };
+	if (node.IsTerminalNode()) {
+		return UpdatedPlayerUtility(node.Utility(), is_player_one);
+	}
+	const int num_children = node.NumChildren();
+	const long long first_child = levels.FirstChild(node_index);
+
+	//Strategy is read once, as other threads may update the info set meanwhile, and the
+	//same strategy is accumulated into the cumulative strategy. The info set is read
+	//with its relaxed loads, as its updates run under a lock this thread does not hold.
+	NodeValues child_weights(num_children);
+	Byte* info_set_pos = node.IsPlayerNode() ? node.InfoSetPosition() : nullptr;
+	if (node.IsChanceNode()) {
+		for (int i_child = 0; i_child < num_children; i_child++) {
+			child_weights[i_child] = node.ChildProbability(i_child);
+		}
+	}
+	else {
+		InfoSetData info_set = InfoSetData(info_set_pos);
+		info_set.LoadCurrentStrategy(child_weights.data());
+	}
+
+	NodeWalkValues child_values(num_children);
+	auto walk_child = [&](int i_child) {
+		WalkValue child_player_one_reach = player_one_reach_prob;
+		WalkValue child_player_two_reach = player_two_reach_prob;
+		if (node.IsPlayerNode() && node.IsPlayerOne()) {
+			child_player_one_reach *= child_weights[i_child];
+		}
+		else if (node.IsPlayerNode()) {
+			child_player_two_reach *= child_weights[i_child];
+		}
+		child_values[i_child] = WalkTreeTasks(levels, pool, info_set_locks, first_child + i_child,
+			is_player_one, child_player_one_reach, child_player_two_reach, grain_size);
+	};
+
+	if (levels.SubtreeSize(node_index) > grain_size && num_children > 1) {
+		//Fork all but the first child, walk the first here, then join newest first.
+		std::vector<CfrTask> tasks(num_children - 1);
+		for (int i_child = 1; i_child < num_children; i_child++) {
+			tasks[i_child - 1].func = [&walk_child, i_child] { walk_child(i_child); };
+			pool.Fork(tasks[i_child - 1]);
+		}
+		walk_child(0);
+		for (auto i_task = tasks.rbegin(); i_task != tasks.rend(); i_task++) {
+			pool.Join(*i_task);
+		}
+	}
+	else {
+		for (int i_child = 0; i_child < num_children; i_child++) {
+			walk_child(i_child);
+		}
+	}
+
+	WalkValue val = 0;
+	for (int i_child = 0; i_child < num_children; i_child++) {
+		val += static_cast<WalkValue>(child_weights[i_child]) * child_values[i_child];
+	}
+	if (node.IsPlayerNode() && node.IsPlayerOne() == is_player_one)
 	{
-		if (regret_sum > 0)
+		const WalkValue regret_prob = is_player_one ? player_two_reach_prob : player_one_reach_prob;
+		const WalkValue strat_prob = is_player_one ? player_one_reach_prob : player_two_reach_prob;
+		NodeValues child_utilities(num_children);
+		for (int i_child = 0; i_child < num_children; i_child++) {
+			child_utilities[i_child] = static_cast<float>(child_values[i_child]);
+		}
+		//Positions are mixed, as cache aligned info sets would otherwise share a few stripes.
+		const std::uint64_t info_set_word = reinterpret_cast<std::uintptr_t>(info_set_pos) / sizeof(float);
+		const std::size_t stripe = static_cast<std::size_t>(( info_set_word * 0x9E3779B97F4A7C15ull ) >> 32) % info_set_locks.size();
+		std::lock_guard<std::mutex> lock(info_set_locks[stripe]);
+		InfoSetData info_set = InfoSetData(info_set_pos);
+		//Readers of the info set do not take its lock, so it is updated with relaxed stores.
+		AccumulateRegrets(info_set, child_weights.data(), child_utilities.data(), static_cast<float>(val),
+			static_cast<float>(regret_prob), static_cast<float>(strat_prob), true);
+		if constexpr (kMatchPerVisit) {
+			RegretMatching(info_set, true);
+		}
+	}
+	return val;
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+AccumulateRegrets(
+	InfoSetData& info_set, const float* current_strategy, const float* child_utilities, float val,
+	float regret_prob, float strat_prob, bool shared_table
+) {
+	if (info_set.Precision() != InfoSetPrecision::kFloat32) {
+		//Reduced precision values are converted one at a time by the info set.
+		for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
 		{
-			float curr_strat = info_set.GetCurrentStrategy(i_action);
-			info_set.SetCurrentStrategy(curr_strat / regret_sum, i_action);
+			info_set.AddToCumulativeRegret(regret_prob * (child_utilities[i_action] - val), i_action);
+			info_set.AddToCumulativeStrategy(strat_prob * current_strategy[i_action], i_action);
 		}
-		else
+	}
+	else if (shared_table) {
+		//Other threads read and update the info set, so the vector kernels' plain loads and
+		//stores are not used on it.
+		for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
 		{
-			info_set.SetCurrentStrategy(uniform_prob, i_action);
+			info_set.AddToCumulativeRegret(regret_prob * (child_utilities[i_action] - val), i_action);
+			info_set.AddToCumulativeStrategy(strat_prob * current_strategy[i_action], i_action);
+		}
+	}
+	else if constexpr (kUnrolledActions) {
+		CfrKernels::AccumulateRegretsUnrolled<kMaxActions>(
+			info_set.CumulativeRegretData(), child_utilities, val, regret_prob, info_set.NumActions()
+		);
+		CfrKernels::AccumulateStrategyUnrolled<kMaxActions>(
+			info_set.CumulativeStrategyData(), current_strategy, strat_prob, info_set.NumActions()
+		);
+	}
+	else {
+		CfrKernels::AccumulateRegrets(
+			info_set.CumulativeRegretData(), child_utilities, val, regret_prob, info_set.NumActions()
+		);
+		CfrKernels::AccumulateStrategy(
+			info_set.CumulativeStrategyData(), current_strategy, strat_prob, info_set.NumActions()
+		);
+	}
+	if constexpr (Policy::kUpdateRule == CfrUpdateRule::kRegretMatchingPlus) {
+		for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
+		{
+			info_set.FloorCumulativeRegret(i_action, shared_table);
 		}
 	}
 }
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
-AverageStrategy(const SearchTreeNode& node, std::unordered_set<Byte*> already_evaluated) {
-	if (node.IsTerminalNode())
-	{
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+RegretMatching(InfoSetData& info_set, bool shared_table) {
+	if (!info_set.StoresCurrentStrategy()) {
+		info_set.ResumeRegretMatching();
 		return;
 	}
-	else if (node.IsChanceNode())
-	{
-		std::vector<SearchTreeNode> children = node.AllChildren();
-		for (auto& i_child : children)
+	if (info_set.Precision() != InfoSetPrecision::kFloat32) {
+		ActionValues regrets(info_set.NumActions());
+		for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
 		{
-			AverageStrategy(i_child, already_evaluated);
+			regrets[i_action] = info_set.GetCumulativeRegret(i_action);
+		}
+		if (!shared_table) {
+			CfrKernels::RegretMatching(regrets.data(), info_set.CurrentStrategyData(), info_set.NumActions());
+			return;
 		}
+		StoreMatchedStrategy(info_set, regrets.data());
+		return;
+	}
+	if (shared_table) {
+		ActionValues regrets(info_set.NumActions());
+		for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
+		{
+			regrets[i_action] = info_set.GetCumulativeRegret(i_action);
+		}
+		StoreMatchedStrategy(info_set, regrets.data());
+	}
+	else if constexpr (kUnrolledActions) {
+		CfrKernels::RegretMatchingUnrolled<kMaxActions>(
+			info_set.CumulativeRegretData(), info_set.CurrentStrategyData(), info_set.NumActions()
+		);
 	}
 	else {
-		std::vector<SearchTreeNode> children = node.AllChildren();
-		Byte* info_set_ptr = node.InfoSetPosition();
+		CfrKernels::RegretMatching(
+			info_set.CumulativeRegretData(), info_set.CurrentStrategyData(), info_set.NumActions()
+		);
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+MatchRegretTable(bool shared_table) {
+	//Info sets are stored back to back, so the table is walked by their sizes.
+	for (Byte* pos = regret_table_; pos < regret_table_ + info_set_table_size_;) {
+		InfoSetData info_set = InfoSetData(pos);
+		RegretMatching(info_set, shared_table);
+		pos += info_set.size();
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+StoreMatchedStrategy(InfoSetData& info_set, float* regrets) {
+	CfrKernels::RegretMatching(regrets, regrets, info_set.NumActions());
+	for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
+	{
+		info_set.SetCurrentStrategy(regrets[i_action], i_action);
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+AverageStrategy(const SearchTreeNode& node, std::unordered_set<Byte*>& already_evaluated) {
+	VisitPreOrder(node, [&already_evaluated](const SearchTreeNode& visited_node) {
+		if (!visited_node.IsPlayerNode())
+		{
+			return;
+		}
+		Byte* info_set_ptr = visited_node.InfoSetPosition();
 		if (!already_evaluated.contains(info_set_ptr)) {
-			InfoSetData info_set = node.InfoSetPosition();
-			float normalizing_sum = 0;
-			for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
-			{
-				normalizing_sum += info_set.GetCumulativeStrategy(i_action);
-			}
-			for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
-			{
-				if (normalizing_sum > 0)
-				{
-					float curr_strat_sum = info_set.GetCumulativeStrategy(i_action);
-					info_set.SetCurrentStrategy(curr_strat_sum / normalizing_sum, i_action);
-				}
-				else
+			InfoSetData info_set = visited_node.InfoSetPosition();
+			info_set.UseAverageStrategy();
+			already_evaluated.insert(info_set_ptr);
+		}
+	});
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+template<typename Visit>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+VisitPreOrder(const SearchTreeNode& root, Visit&& visit) {
+	WalkStack<ChildCursor> stack;
+	visit(root);
+	if (!root.IsTerminalNode()) {
+		stack.Push(ChildCursor{ root.ChildrenStartOffset(), root.NumChildren() });
+	}
+	while (!stack.Empty()) {
+		ChildCursor& cursor = stack.Top();
+		if (cursor.remaining_children == 0) {
+			stack.Pop();
+			continue;
+		}
+		const SearchTreeNode child{ cursor.next_child };
+		cursor.next_child += TreeUtils::NodeSizeAt(cursor.next_child);
+		cursor.remaining_children--;
+		visit(child);
+		if (!child.IsTerminalNode()) {
+			stack.Push(ChildCursor{ child.ChildrenStartOffset(), child.NumChildren() });
+		}
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline float CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+Exploitability() const {
+	float best_response_sum = 0;
+	for (const bool is_player_one : { true, false }) {
+		BestResponse best_response;
+		best_response.is_player_one = is_player_one;
+		CollectBestResponseNodes(game_tree_, best_response);
+		best_response_sum += BestResponseValue(game_tree_, best_response);
+	}
+	//The game value cancels out of the sum, leaving what both players gain by deviating.
+	return best_response_sum / 2;
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+CollectBestResponseNodes(Byte* root_pos, BestResponse& best_response) {
+	WalkStack<ReachCursor> stack;
+	auto visit = [&](Byte* node_pos, float reach_prob) {
+		const SearchTreeNode node{ node_pos };
+		if (node.IsTerminalNode())
+		{
+			return;
+		}
+		const std::size_t probs_offset = stack.PushValues(node.NumChildren());
+		float* child_probs = stack.Values(probs_offset);
+		if (node.IsChanceNode())
+		{
+			const std::span<const float> chance_probs = node.ChildProbabilitySpan();
+			std::copy(chance_probs.begin(), chance_probs.end(), child_probs);
+		}
+		else if (node.IsPlayerOne() == best_response.is_player_one)
+		{
+			best_response.info_set_nodes[node.InfoSetPosition()].push_back({ node_pos, reach_prob });
+			std::fill(child_probs, child_probs + node.NumChildren(), 1.0f);
+		}
+		else
+		{
+			InfoSetData info_set = InfoSetData(node.InfoSetPosition());
+			AverageStrategyOf(info_set, child_probs);
+		}
+		stack.Push(ReachCursor{ node.ChildrenStartOffset(), node.NumChildren(), 0, reach_prob, probs_offset });
+	};
+	visit(root_pos, 1.0f);
+	while (!stack.Empty()) {
+		ReachCursor& cursor = stack.Top();
+		if (cursor.child_index == cursor.num_children) {
+			stack.PopValues(cursor.num_children);
+			stack.Pop();
+			continue;
+		}
+		Byte* child_pos = cursor.next_child;
+		const float child_reach_prob = cursor.reach_prob * stack.Values(cursor.probs_offset)[cursor.child_index];
+		cursor.next_child += TreeUtils::NodeSizeAt(child_pos);
+		cursor.child_index++;
+		visit(child_pos, child_reach_prob);
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline float CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+BestResponseValue(Byte* root_pos, BestResponse& best_response) {
+	float root_value;
+	if (KnownBestResponseValue(root_pos, best_response, root_value))
+	{
+		return root_value;
+	}
+	WalkStack<BestResponseFrame> stack;
+	PushBestResponseNode(stack, root_pos, best_response);
+	while (true) {
+		BestResponseFrame& frame = stack.Top();
+		float child_value;
+		if (frame.child_index == frame.num_children) {
+			const float* values = stack.Values(frame.values_offset);
+			if (frame.node_pos == nullptr) {
+				int best_action = 0;
+				for (int i_action = 1; i_action < frame.num_actions; i_action++)
 				{
-					info_set.SetCurrentStrategy(1.0f / static_cast<float>(info_set.NumActions()), i_action);
+					if (values[i_action] > values[best_action])
+					{
+						best_action = i_action;
+					}
 				}
+				best_response.actions[frame.info_set_pos] = best_action;
+				stack.PopValues(frame.num_values);
+				stack.Pop();
+				//The node of the responder below now walks the child the action leads to.
+				BestResponseFrame& responder = stack.Top();
+				responder.next_child = ChildPosition(SearchTreeNode{ responder.node_pos }, best_action);
+				continue;
+			}
+			child_value = frame.val;
+			best_response.node_values[frame.node_pos] = child_value;
+			stack.PopValues(frame.num_values);
+			stack.Pop();
+			if (stack.Empty()) {
+				return child_value;
 			}
-			already_evaluated.insert(info_set_ptr);
 		}
-	
-		for (auto& i_child : children)
+		else {
+			if (frame.node_pos == nullptr && frame.child_index % frame.num_actions == 0) {
+				Byte* info_set_node = ( *frame.info_set_nodes )[frame.child_index / frame.num_actions].first;
+				frame.next_child = SearchTreeNode{ info_set_node }.ChildrenStartOffset();
+			}
+			Byte* child_pos = frame.next_child;
+			frame.next_child += TreeUtils::NodeSizeAt(child_pos);
+			if (!KnownBestResponseValue(child_pos, best_response, child_value)) {
+				PushBestResponseNode(stack, child_pos, best_response);
+				continue;
+			}
+		}
+
+		//Adds the child's value to the frame walking it, in the order the children are walked.
+		BestResponseFrame& parent = stack.Top();
+		float* values = stack.Values(parent.values_offset);
+		if (parent.node_pos == nullptr) {
+			const float reach_prob = ( *parent.info_set_nodes )[parent.child_index / parent.num_actions].second;
+			values[parent.child_index % parent.num_actions] += reach_prob * child_value;
+		}
+		else if (parent.num_values == 0) {
+			parent.val = child_value;
+		}
+		else {
+			parent.val += values[parent.child_index] * child_value;
+		}
+		parent.child_index++;
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline bool CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+KnownBestResponseValue(Byte* node_pos, const BestResponse& best_response, float& value) {
+	const SearchTreeNode node{ node_pos };
+	if (node.IsTerminalNode())
+	{
+		value = best_response.is_player_one ? node.Utility() : -node.Utility();
+		return true;
+	}
+	const auto memoized = best_response.node_values.find(node_pos);
+	if (memoized != best_response.node_values.end())
+	{
+		value = memoized->second;
+		return true;
+	}
+	return false;
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+PushBestResponseNode(WalkStack<BestResponseFrame>& stack, Byte* node_pos, BestResponse& best_response) {
+	const SearchTreeNode node{ node_pos };
+	BestResponseFrame& frame = stack.Push();
+	frame.node_pos = node_pos;
+	if (node.IsPlayerNode() && node.IsPlayerOne() == best_response.is_player_one)
+	{
+		frame.num_children = 1;
+		Byte* info_set_pos = node.InfoSetPosition();
+		const auto action = best_response.actions.find(info_set_pos);
+		if (action != best_response.actions.end())
 		{
-			AverageStrategy(i_child, already_evaluated);
+			frame.next_child = ChildPosition(node, action->second);
+			return;
 		}
+		const std::vector<std::pair<Byte*, float>>& info_set_nodes = best_response.info_set_nodes.at(info_set_pos);
+		const int num_actions = node.NumChildren();
+		const std::size_t values_offset = stack.PushValues(num_actions);
+		std::fill(stack.Values(values_offset), stack.Values(values_offset) + num_actions, 0.0f);
+		BestResponseFrame& info_set_frame = stack.Push();
+		info_set_frame.info_set_pos = info_set_pos;
+		info_set_frame.info_set_nodes = &info_set_nodes;
+		info_set_frame.num_children = num_actions * static_cast<int>(info_set_nodes.size());
+		info_set_frame.num_actions = num_actions;
+		info_set_frame.values_offset = values_offset;
+		info_set_frame.num_values = num_actions;
+		return;
+	}
+	frame.next_child = node.ChildrenStartOffset();
+	frame.num_children = node.NumChildren();
+	frame.values_offset = stack.PushValues(node.NumChildren());
+	frame.num_values = node.NumChildren();
+	float* child_probs = stack.Values(frame.values_offset);
+	if (node.IsChanceNode())
+	{
+		const std::span<const float> chance_probs = node.ChildProbabilitySpan();
+		std::copy(chance_probs.begin(), chance_probs.end(), child_probs);
+	}
+	else
+	{
+		InfoSetData info_set = InfoSetData(node.InfoSetPosition());
+		AverageStrategyOf(info_set, child_probs);
+	}
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline Byte* CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+ChildPosition(const SearchTreeNode& node, int i_child) {
+	Byte* child_pos = node.ChildrenStartOffset();
+	for (int i_sibling = 0; i_sibling < i_child; i_sibling++)
+	{
+		child_pos += TreeUtils::NodeSizeAt(child_pos);
+	}
+	return child_pos;
+}
+
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+	requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+AverageStrategyOf(InfoSetData& info_set, float* strategy) {
+	float normalizing_sum = 0;
+	for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
+	{
+		strategy[i_action] = info_set.GetCumulativeStrategy(i_action);
+		normalizing_sum += strategy[i_action];
+	}
+	for (int i_action = 0; i_action < info_set.NumActions(); i_action++)
+	{
+		strategy[i_action] = normalizing_sum > 0 ? strategy[i_action] / normalizing_sum
+			: 1.0f / static_cast<float>(info_set.NumActions());
 	}
 }
 
@@ -705,19 +3025,13 @@ AverageStrategy(const SearchTreeNode& node, std::unordered_set<Byte*> already_ev
 */
 
 
-template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass>
-inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass>::
-PrintTreeRecursive(const SearchTreeNode& node) {
+template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass, typename Policy>
+requires GenericCfrRequirements<Action, PlayerNode, ChanceNode, GameClass> && CfrPolicyRequirements<Policy>
+inline void CfrTree<Action, PlayerNode, ChanceNode, GameClass, Policy>::
+PrintSubtree(const SearchTreeNode& node) {
 	
-	std::cout << node;
-	if (node.IsPlayerNode() || node.IsChanceNode()) {
-		
-		std::vector<SearchTreeNode> children = node.AllChildren();
-		for (SearchTreeNode& child_node : children) {
-			PrintTreeRecursive(child_node);
-		}
-	}
-	return;
+	VisitPreOrder(node, [](const SearchTreeNode& visited_node) {
+		std::cout << visited_node;
+	});
 }
 
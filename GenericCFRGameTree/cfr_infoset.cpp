@@ -2,36 +2,278 @@
 #include "pch.h"
 #include "framework.h"
 #include "cfr_tree_nodes.h"
+#include "cfr_kernels.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <new>
 
 
-int TreeUtils::InfoSetSize(int num_actions) {
-	return sizeof(uint8_t) + ( 3 * num_actions * sizeof(float) );
+int TreeUtils::InfoSetArraySize(int num_actions, InfoSetLayout layout, int value_size)
+{
+	if (layout == InfoSetLayout::kCacheAligned) {
+		return ( num_actions * value_size + kInfoSetArrayAlignment - 1 ) / kInfoSetArrayAlignment * kInfoSetArrayAlignment;
+	}
+	return num_actions * value_size;
+}
+
+int TreeUtils::InfoSetValueSize(InfoSetPrecision precision)
+{
+	return precision == InfoSetPrecision::kBFloat16 ? sizeof(std::uint16_t) : sizeof(float);
 }
 
-TreeUtils::Byte* TreeUtils::SetInfoSetNode(Byte* pos, int num_actions)
+int TreeUtils::InfoSetPrefixSize(InfoSetLayout layout, InfoSetPrecision precision)
 {
-	*(pos++) = static_cast<uint8_t>(num_actions);
+	if (layout == InfoSetLayout::kCacheAligned) {
+		return kInfoSetArrayAlignment;
+	}
+	return kInfoSetHeaderSize + ( precision == InfoSetPrecision::kBFloat16 ? kInfoSetScaleSize : 0 );
+}
+
+int TreeUtils::InfoSetSize(int num_actions, InfoSetLayout layout, InfoSetPrecision precision) {
+	const int strategy_size = layout == InfoSetLayout::kDerivedStrategy ? 0
+		: InfoSetArraySize(num_actions, layout, sizeof(float));
+	const int cumulative_size = 2 * InfoSetArraySize(num_actions, layout, InfoSetValueSize(precision));
+	const int size = InfoSetPrefixSize(layout, precision) + strategy_size + cumulative_size;
+	if (layout == InfoSetLayout::kCacheAligned) {
+		return ( size + kCacheLineSize - 1 ) / kCacheLineSize * kCacheLineSize;
+	}
+	//Two arrays of 16 bit values always end on a float boundary.
+	return size;
+}
+
+TreeUtils::Byte* TreeUtils::SetInfoSetNode(Byte* pos, int num_actions, InfoSetLayout layout, InfoSetPrecision precision)
+{
+	//Padding is zeroed, so it never holds stale values when read as part of a vector.
+	//Zero is also zero in every precision.
+	const int info_set_size = InfoSetSize(num_actions, layout, precision);
+	std::memset(pos, 0, info_set_size);
+	std::uint32_t header = static_cast<std::uint32_t>(num_actions);
+	if (layout == InfoSetLayout::kCacheAligned) {
+		header |= kInfoSetAlignedFlag;
+	}
+	else if (layout == InfoSetLayout::kDerivedStrategy) {
+		header |= kInfoSetDerivedFlag;
+	}
+	header |= static_cast<std::uint32_t>(precision) << kInfoSetPrecisionShift;
+	std::memcpy(pos, &header, sizeof(header));
+	if (precision == InfoSetPrecision::kBFloat16) {
+		std::memcpy(pos + kInfoSetHeaderSize, &kInitialStrategyScale, sizeof(float));
+	}
+	//Setting the current strategy is ignored when it is derived, as zero regrets derive it uniform.
+	InfoSetData info_set{ pos };
 	const float uniform_prob = 1.0f / static_cast<float>(num_actions);
 	for (int i_uniform_strat = 0; i_uniform_strat < num_actions; i_uniform_strat++) {
-		TreeUtils::SetFloatAtBytePtr(pos, uniform_prob);
-		pos += sizeof(float);
-	}
-	for (int i_cumulative = 0; i_cumulative < 2 * num_actions; i_cumulative++) {
-		TreeUtils::SetFloatAtBytePtr(pos, 0.0);
-		pos += sizeof(float);
+		info_set.SetCurrentStrategy(uniform_prob, i_uniform_strat);
 	}
 	//Return pointer to next info set.
-	return pos;
+	return pos + info_set_size;
+}
+
+TreeUtils::Byte* TreeUtils::AllocateRegretTable(long long size)
+{
+	return static_cast<Byte*>(::operator new[](static_cast<std::size_t>(size), std::align_val_t{ kCacheLineSize }));
+}
+
+void TreeUtils::FreeRegretTable(Byte* regret_table)
+{
+	::operator delete[](regret_table, std::align_val_t{ kCacheLineSize });
 }
 
 using Byte = unsigned char;
 
+/**
+ * @brief Relaxed atomic access to a float in the regret table.
+ */
+static float LoadInfoSetFloat(Byte* p_byte)
+{
+	return std::atomic_ref<float>(*reinterpret_cast<float*>( p_byte )).load(std::memory_order_relaxed);
+}
+
+static void StoreInfoSetFloat(Byte* p_byte, float val)
+{
+	std::atomic_ref<float>(*reinterpret_cast<float*>( p_byte )).store(val, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Random bits for stochastic rounding, from a xorshift generator per thread.
+ */
+static std::uint32_t RoundingBits()
+{
+	thread_local std::uint32_t state = 0x9E3779B9u;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+/**
+ * @return val rounded down or up to a whole number, up with probability equal to its fraction.
+ */
+static double StochasticRound(double val)
+{
+	return std::floor(val + static_cast<double>(RoundingBits()) * ( 1.0 / 4294967296.0 ));
+}
+
+/**
+ * @brief Loads a cumulative value stored with any precision, as a float.
+ */
+static float LoadInfoSetValue(Byte* p_byte, InfoSetPrecision precision)
+{
+	if (precision == InfoSetPrecision::kBFloat16) {
+		const std::uint32_t bits = std::uint32_t{ std::atomic_ref<std::uint16_t>(
+			*reinterpret_cast<std::uint16_t*>( p_byte )).load(std::memory_order_relaxed) } << 16;
+		float val;
+		std::memcpy(&val, &bits, sizeof(val));
+		return val;
+	}
+	if (precision == InfoSetPrecision::kFixed32) {
+		const std::int32_t fixed = std::atomic_ref<std::int32_t>(
+			*reinterpret_cast<std::int32_t*>( p_byte )).load(std::memory_order_relaxed);
+		return static_cast<float>(fixed) * TreeUtils::kFixedPointScale;
+	}
+	return LoadInfoSetFloat(p_byte);
+}
+
+/**
+ * @brief Adds to a cumulative value stored with any precision.
+ */
+static void AddToInfoSetValue(Byte* p_byte, InfoSetPrecision precision, float val)
+{
+	if (precision == InfoSetPrecision::kBFloat16) {
+		const float total = LoadInfoSetValue(p_byte, precision) + val;
+		std::uint32_t bits;
+		std::memcpy(&bits, &total, sizeof(bits));
+		//Random low bits carry into the kept half with probability equal to the dropped
+		//fraction. Values within a rounding of infinity are truncated instead.
+		const std::uint32_t rounded = bits + ( RoundingBits() & 0xFFFFu );
+		const std::uint32_t kExponentMask = 0x7F800000u;
+		if (( bits & kExponentMask ) != kExponentMask && ( rounded & kExponentMask ) != kExponentMask) {
+			bits = rounded;
+		}
+		std::atomic_ref<std::uint16_t>(*reinterpret_cast<std::uint16_t*>( p_byte ))
+			.store(static_cast<std::uint16_t>(bits >> 16), std::memory_order_relaxed);
+		return;
+	}
+	if (precision == InfoSetPrecision::kFixed32) {
+		//Sums are exact integers, clamped to the 32 bit range. Updates are rounded
+		//stochastically, as most are smaller than the resolution in games with rare chance
+		//outcomes or deep trees, and rounding to nearest would drop them entirely.
+		const double kLimit = 2147483648.0;
+		double scaled = static_cast<double>(val) / TreeUtils::kFixedPointScale;
+		scaled = scaled > kLimit ? kLimit : scaled < -kLimit ? -kLimit : scaled;
+		std::atomic_ref<std::int32_t> fixed(*reinterpret_cast<std::int32_t*>( p_byte ));
+		long long total = static_cast<long long>(fixed.load(std::memory_order_relaxed))
+			+ static_cast<long long>(StochasticRound(scaled));
+		total = total > INT32_MAX ? INT32_MAX : total < INT32_MIN ? INT32_MIN : total;
+		fixed.store(static_cast<std::int32_t>(total), std::memory_order_relaxed);
+		return;
+	}
+	StoreInfoSetFloat(p_byte, LoadInfoSetFloat(p_byte) + val);
+}
+
+/**
+ * @brief Sets a negative cumulative value to zero, which is all zero bits in every
+ *		  precision. In a shared table the value is only replaced while still negative,
+ *		  so an addition another thread makes between the check and the store is kept.
+ */
+template<typename Bits, typename IsNegative>
+static void FloorInfoSetBits(Byte* p_byte, bool shared_table, IsNegative is_negative)
+{
+	std::atomic_ref<Bits> value(*reinterpret_cast<Bits*>( p_byte ));
+	Bits expected = value.load(std::memory_order_relaxed);
+	if (!shared_table) {
+		if (is_negative(expected)) {
+			value.store(Bits{}, std::memory_order_relaxed);
+		}
+		return;
+	}
+	while (is_negative(expected) && !value.compare_exchange_weak(expected, Bits{}, std::memory_order_relaxed)) {
+	}
+}
+
+static void FloorInfoSetValue(Byte* p_byte, InfoSetPrecision precision, bool shared_table)
+{
+	if (precision == InfoSetPrecision::kBFloat16) {
+		FloorInfoSetBits<std::uint16_t>(p_byte, shared_table, [](std::uint16_t bits) { return ( bits & 0x8000u ) != 0; });
+	}
+	else if (precision == InfoSetPrecision::kFixed32) {
+		FloorInfoSetBits<std::int32_t>(p_byte, shared_table, [](std::int32_t fixed) { return fixed < 0; });
+	}
+	else {
+		FloorInfoSetBits<float>(p_byte, shared_table, [](float val) { return val < 0; });
+	}
+}
+
+static std::atomic_ref<std::uint16_t> ScaledValue(Byte* p_values, int index)
+{
+	return std::atomic_ref<std::uint16_t>(*reinterpret_cast<std::uint16_t*>( p_values + sizeof(std::uint16_t) * index ));
+}
+
+/**
+ * @brief Loads a value of a kBFloat16 cumulative strategy, stored as a 16 bit integer
+ *		  times the scale its info set's values share.
+ */
+static float LoadScaledValue(Byte* p_values, Byte* p_scale, int index)
+{
+	return static_cast<float>(ScaledValue(p_values, index).load(std::memory_order_relaxed)) * LoadInfoSetFloat(p_scale);
+}
+
+/**
+ * @brief Adds a non negative update to a value of a kBFloat16 cumulative strategy. A sum
+ *		  outgrowing 16 bits raises the shared scale by the power of two that fits it, and
+ *		  every other value of the array is scaled down to match.
+ */
+static void AddToScaledValue(Byte* p_values, Byte* p_scale, int num_values, int index, float val)
+{
+	float scale = LoadInfoSetFloat(p_scale);
+	double total = static_cast<double>(ScaledValue(p_values, index).load(std::memory_order_relaxed))
+		+ static_cast<double>(val) / scale;
+	total = total > 0 ? total : 0;
+	if (total > TreeUtils::kMaxScaledStrategy) {
+		int exponent;
+		std::frexp(total / TreeUtils::kMaxScaledStrategy, &exponent);
+		const double shrink = std::ldexp(1.0, -exponent);
+		for (int i_value = 0; i_value < num_values; i_value++) {
+			if (i_value != index) {
+				std::atomic_ref<std::uint16_t> other = ScaledValue(p_values, i_value);
+				other.store(static_cast<std::uint16_t>(StochasticRound(other.load(std::memory_order_relaxed) * shrink)),
+					std::memory_order_relaxed);
+			}
+		}
+		total *= shrink;
+		StoreInfoSetFloat(p_scale, std::ldexp(scale, exponent));
+	}
+	const double rounded = StochasticRound(total);
+	ScaledValue(p_values, index).store(static_cast<std::uint16_t>(
+		rounded < TreeUtils::kMaxScaledStrategy ? rounded : TreeUtils::kMaxScaledStrategy), std::memory_order_relaxed);
+}
+
 InfoSetData::InfoSetData(byte* pos)
 {
-	this->num_actions_ = ( uint8_t ) *(pos++);
-	int arr_size = static_cast<int>(num_actions_) * sizeof(float);
-	this->p_curr_strategy_ = pos;
-	pos += arr_size;
+	//Read atomically, as UseAverageStrategy and ResumeRegretMatching may flip a flag on another thread.
+	const std::uint32_t header = std::atomic_ref<std::uint32_t>(
+		*reinterpret_cast<std::uint32_t*>( pos )).load(std::memory_order_relaxed);
+	this->p_header_ = pos;
+	this->averaged_ = ( header & TreeUtils::kInfoSetAveragedFlag ) != 0;
+	this->positive_regret_sum_ = -1.0f;
+	this->cumulative_strategy_sum_ = -1.0f;
+	this->num_actions_ = static_cast<int>(header & TreeUtils::kInfoSetCountMask);
+	this->layout_ = ( header & TreeUtils::kInfoSetAlignedFlag ) ? InfoSetLayout::kCacheAligned
+		: ( header & TreeUtils::kInfoSetDerivedFlag ) ? InfoSetLayout::kDerivedStrategy : InfoSetLayout::kPacked;
+	this->precision_ = static_cast<InfoSetPrecision>(
+		( header & TreeUtils::kInfoSetPrecisionMask ) >> TreeUtils::kInfoSetPrecisionShift);
+	this->p_strategy_scale_ = precision_ == InfoSetPrecision::kBFloat16 ? pos + TreeUtils::kInfoSetHeaderSize : nullptr;
+	pos += TreeUtils::InfoSetPrefixSize(layout_, precision_);
+	if (layout_ == InfoSetLayout::kDerivedStrategy) {
+		this->p_curr_strategy_ = nullptr;
+	}
+	else {
+		this->p_curr_strategy_ = pos;
+		pos += TreeUtils::InfoSetArraySize(num_actions_, layout_, sizeof(float));
+	}
+	int arr_size = TreeUtils::InfoSetArraySize(num_actions_, layout_, TreeUtils::InfoSetValueSize(precision_));
 	this->p_cum_strategy_ = pos;
 	pos += arr_size;
 	this->p_cum_regret_ = pos;
@@ -40,7 +282,7 @@ InfoSetData::InfoSetData(byte* pos)
 
 int InfoSetData::size()
 {
-	return (3 * num_actions_ * sizeof(float)) + sizeof(uint8_t);
+	return TreeUtils::InfoSetSize(num_actions_, layout_, precision_);
 }
 
 int InfoSetData::NumActions()
@@ -48,42 +290,244 @@ int InfoSetData::NumActions()
 	return this->num_actions_;
 }
 
+InfoSetPrecision InfoSetData::Precision()
+{
+	return this->precision_;
+}
+
+float InfoSetData::PositiveRegretSum()
+{
+	if (this->positive_regret_sum_ < 0) {
+		float regret_sum = 0;
+		for (int i_action = 0; i_action < num_actions_; i_action++) {
+			const float action_regret = GetCumulativeRegret(i_action);
+			regret_sum += action_regret > 0 ? action_regret : 0.0f;
+		}
+		this->positive_regret_sum_ = regret_sum;
+	}
+	return this->positive_regret_sum_;
+}
+
+float InfoSetData::CumulativeStrategySum()
+{
+	if (this->cumulative_strategy_sum_ < 0) {
+		float normalizing_sum = 0;
+		for (int i_action = 0; i_action < num_actions_; i_action++) {
+			normalizing_sum += GetCumulativeStrategy(i_action);
+		}
+		this->cumulative_strategy_sum_ = normalizing_sum;
+	}
+	return this->cumulative_strategy_sum_;
+}
+
 float InfoSetData::GetCurrentStrategy(int index)
 {
+	if (this->p_curr_strategy_ == nullptr) {
+		if (this->averaged_) {
+			return GetAverageStrategy(index);
+		}
+		const float regret_sum = PositiveRegretSum();
+		if (regret_sum <= 0) {
+			return 1.0f / static_cast<float>(num_actions_);
+		}
+		const float action_regret = GetCumulativeRegret(index);
+		return action_regret > 0 ? action_regret / regret_sum : 0.0f;
+	}
 	byte* iFloat = this->p_curr_strategy_ + ( sizeof(float) * index );
-	return TreeUtils::GetFloatFromBytePtr(iFloat);
+	return LoadInfoSetFloat(iFloat);
 }
 
 float InfoSetData::GetCumulativeStrategy(int index)
 {
-	byte* iFloat = this->p_cum_strategy_ + ( sizeof(float) * index );
-	return TreeUtils::GetFloatFromBytePtr(iFloat);
+	if (this->p_strategy_scale_ != nullptr) {
+		return LoadScaledValue(this->p_cum_strategy_, this->p_strategy_scale_, index);
+	}
+	byte* iValue = this->p_cum_strategy_ + ( TreeUtils::InfoSetValueSize(precision_) * index );
+	return LoadInfoSetValue(iValue, precision_);
 }
 
 float InfoSetData::GetCumulativeRegret(int index)
 {
-	byte* iFloat = this->p_cum_regret_ + ( sizeof(float) * index );
-	return TreeUtils::GetFloatFromBytePtr(iFloat);
+	byte* iValue = this->p_cum_regret_ + ( TreeUtils::InfoSetValueSize(precision_) * index );
+	return LoadInfoSetValue(iValue, precision_);
 }
 
 void InfoSetData::SetCurrentStrategy(float prob, int index)
 {
+	if (this->p_curr_strategy_ == nullptr) {
+		return;
+	}
 	byte* iFloat = this->p_curr_strategy_ + (sizeof(float) * index);
-	TreeUtils::SetFloatAtBytePtr(iFloat, prob);
+	StoreInfoSetFloat(iFloat, prob);
 }
 
 void InfoSetData::AddToCumulativeStrategy(float prob, int index)
 {
-	float newTotal = GetCumulativeStrategy(index) + prob;
-	byte* iFloat =  this->p_cum_strategy_ + ( sizeof(float) * index );
-	TreeUtils::SetFloatAtBytePtr(iFloat, newTotal);
+	this->cumulative_strategy_sum_ = -1.0f;
+	if (this->p_strategy_scale_ != nullptr) {
+		AddToScaledValue(this->p_cum_strategy_, this->p_strategy_scale_, num_actions_, index, prob);
+		return;
+	}
+	byte* iValue = this->p_cum_strategy_ + ( TreeUtils::InfoSetValueSize(precision_) * index );
+	AddToInfoSetValue(iValue, precision_, prob);
 }
 
 void InfoSetData::AddToCumulativeRegret(float prob, int index)
 {
-	float newTotal = GetCumulativeRegret(index) + prob;
-	byte* iFloat = this->p_cum_regret_ + ( sizeof(float) * index );
-	TreeUtils::SetFloatAtBytePtr(iFloat, newTotal);
+	this->positive_regret_sum_ = -1.0f;
+	byte* iValue = this->p_cum_regret_ + ( TreeUtils::InfoSetValueSize(precision_) * index );
+	AddToInfoSetValue(iValue, precision_, prob);
+}
+
+void InfoSetData::FloorCumulativeRegret(int index, bool shared_table)
+{
+	this->positive_regret_sum_ = -1.0f;
+	byte* iValue = this->p_cum_regret_ + ( TreeUtils::InfoSetValueSize(precision_) * index );
+	FloorInfoSetValue(iValue, precision_, shared_table);
+}
+
+float InfoSetData::GetAverageStrategy(int index)
+{
+	const float normalizing_sum = CumulativeStrategySum();
+	if (normalizing_sum > 0) {
+		return GetCumulativeStrategy(index) / normalizing_sum;
+	}
+	return 1.0f / static_cast<float>(num_actions_);
+}
+
+bool InfoSetData::StoresCurrentStrategy()
+{
+	return this->p_curr_strategy_ != nullptr;
+}
+
+void InfoSetData::UseAverageStrategy()
+{
+	if (this->p_curr_strategy_ == nullptr) {
+		std::atomic_ref<std::uint32_t>(*reinterpret_cast<std::uint32_t*>( this->p_header_ ))
+			.fetch_or(TreeUtils::kInfoSetAveragedFlag, std::memory_order_relaxed);
+		this->averaged_ = true;
+		return;
+	}
+	for (int i_action = 0; i_action < num_actions_; i_action++) {
+		SetCurrentStrategy(GetAverageStrategy(i_action), i_action);
+	}
+}
+
+void InfoSetData::ResumeRegretMatching()
+{
+	//Checked first, so walks after the first update never write the header.
+	if (!this->averaged_) {
+		return;
+	}
+	std::atomic_ref<std::uint32_t>(*reinterpret_cast<std::uint32_t*>( this->p_header_ ))
+		.fetch_and(~TreeUtils::kInfoSetAveragedFlag, std::memory_order_relaxed);
+	this->averaged_ = false;
+}
+
+const float* InfoSetData::CurrentStrategy(float* scratch)
+{
+	if (this->p_curr_strategy_ != nullptr) {
+		return reinterpret_cast<const float*>( this->p_curr_strategy_ );
+	}
+	if (this->averaged_) {
+		return LoadCurrentStrategy(scratch);
+	}
+	if (precision_ != InfoSetPrecision::kFloat32) {
+		//Regret matching reads each regret before writing its probability, so it runs in place.
+		for (int i_action = 0; i_action < num_actions_; i_action++) {
+			scratch[i_action] = GetCumulativeRegret(i_action);
+		}
+		CfrKernels::RegretMatching(scratch, scratch, num_actions_);
+		return scratch;
+	}
+	CfrKernels::RegretMatching(CumulativeRegretData(), scratch, num_actions_);
+	return scratch;
+}
+
+const float* InfoSetData::LoadCurrentStrategy(float* strategy)
+{
+	if (this->p_curr_strategy_ != nullptr) {
+		for (int i_action = 0; i_action < num_actions_; i_action++) {
+			strategy[i_action] = LoadInfoSetFloat(this->p_curr_strategy_ + sizeof(float) * i_action);
+		}
+		return strategy;
+	}
+	if (this->averaged_) {
+		for (int i_action = 0; i_action < num_actions_; i_action++) {
+			strategy[i_action] = GetAverageStrategy(i_action);
+		}
+		return strategy;
+	}
+	for (int i_action = 0; i_action < num_actions_; i_action++) {
+		strategy[i_action] = GetCumulativeRegret(i_action);
+	}
+	CfrKernels::RegretMatching(strategy, strategy, num_actions_);
+	return strategy;
+}
+
+float* InfoSetData::CurrentStrategyData()
+{
+	return reinterpret_cast<float*>( this->p_curr_strategy_ );
+}
+
+float* InfoSetData::CumulativeStrategyData()
+{
+	return precision_ == InfoSetPrecision::kFloat32 ? reinterpret_cast<float*>( this->p_cum_strategy_ ) : nullptr;
+}
+
+float* InfoSetData::CumulativeRegretData()
+{
+	return precision_ == InfoSetPrecision::kFloat32 ? reinterpret_cast<float*>( this->p_cum_regret_ ) : nullptr;
+}
+
+std::pair<long long, bool> InfoSetHashIndex::Insert(std::uint64_t key, long long slot)
+{
+	if (key == 0) {
+		if (has_zero_key_) {
+			return { static_cast<long long>(zero_key_slot_), false };
+		}
+		has_zero_key_ = true;
+		zero_key_slot_ = static_cast<std::uint32_t>(slot);
+		size_++;
+		return { slot, true };
+	}
+	//Keep the table at most half full so probe sequences stay short.
+	if (2 * ( size_ + 1 ) > static_cast<long long>(keys_.size())) {
+		Grow();
+	}
+	const std::size_t mask = keys_.size() - 1;
+	std::size_t i_bucket = static_cast<std::size_t>(key) & mask;
+	while (keys_[i_bucket] != 0) {
+		if (keys_[i_bucket] == key) {
+			return { static_cast<long long>(slots_[i_bucket]), false };
+		}
+		i_bucket = ( i_bucket + 1 ) & mask;
+	}
+	keys_[i_bucket] = key;
+	slots_[i_bucket] = static_cast<std::uint32_t>(slot);
+	size_++;
+	return { slot, true };
+}
+
+void InfoSetHashIndex::Grow()
+{
+	std::vector<std::uint64_t> old_keys = std::move(keys_);
+	std::vector<std::uint32_t> old_slots = std::move(slots_);
+	const std::size_t capacity = old_keys.empty() ? 64 : 2 * old_keys.size();
+	keys_.assign(capacity, 0);
+	slots_.assign(capacity, 0);
+	const std::size_t mask = capacity - 1;
+	for (std::size_t i_old = 0; i_old < old_keys.size(); i_old++) {
+		if (old_keys[i_old] == 0) {
+			continue;
+		}
+		std::size_t i_bucket = static_cast<std::size_t>(old_keys[i_old]) & mask;
+		while (keys_[i_bucket] != 0) {
+			i_bucket = ( i_bucket + 1 ) & mask;
+		}
+		keys_[i_bucket] = old_keys[i_old];
+		slots_[i_bucket] = old_slots[i_old];
+	}
 }
 
 std::ostream& operator<<(std::ostream& os, InfoSetData& info_set)
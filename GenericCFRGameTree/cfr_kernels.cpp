@@ -0,0 +1,270 @@
+#include "pch.h"
+#include "framework.h"
+#include "cfr_kernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CFR_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//MSVC allows AVX2 intrinsics in any function, GCC and Clang only in functions compiled for it.
+#if defined(__GNUC__) || defined(__clang__)
+#define CFR_TARGET(isa) __attribute__(( target(isa) ))
+#else
+#define CFR_TARGET(isa)
+#endif
+
+
+#ifdef CFR_KERNELS_X86
+
+/* ### SSE2 ### */
+
+static float HorizontalSum(__m128 sum)
+{
+	__m128 high = _mm_movehl_ps(sum, sum);
+	sum = _mm_add_ps(sum, high);
+	high = _mm_shuffle_ps(sum, sum, 0x55);
+	return _mm_cvtss_f32(_mm_add_ss(sum, high));
+}
+
+/**
+ * @brief Normalizes the positive regrets already stored in strategy, the second
+ *		  pass shared by the SSE2 and AVX2 regret matching.
+ */
+static void NormalizeStrategySse2(float* strategy, float regret_sum, int num_actions, int i_action)
+{
+	if (regret_sum > 0)
+	{
+		const __m128 sum = _mm_set1_ps(regret_sum);
+		for (; i_action + 4 <= num_actions; i_action += 4)
+		{
+			_mm_storeu_ps(strategy + i_action, _mm_div_ps(_mm_loadu_ps(strategy + i_action), sum));
+		}
+		for (; i_action < num_actions; i_action++)
+		{
+			strategy[i_action] = strategy[i_action] / regret_sum;
+		}
+	}
+	else
+	{
+		const float uniform_prob = 1.0 / static_cast<float>(num_actions);
+		for (; i_action < num_actions; i_action++)
+		{
+			strategy[i_action] = uniform_prob;
+		}
+	}
+}
+
+static void RegretMatchingSse2(const float* cumulative_regret, float* strategy, int num_actions)
+{
+	const __m128 zero = _mm_setzero_ps();
+	__m128 sum = zero;
+	int i_action = 0;
+	for (; i_action + 4 <= num_actions; i_action += 4)
+	{
+		const __m128 positive_regret = _mm_max_ps(_mm_loadu_ps(cumulative_regret + i_action), zero);
+		_mm_storeu_ps(strategy + i_action, positive_regret);
+		sum = _mm_add_ps(sum, positive_regret);
+	}
+	float regret_sum = HorizontalSum(sum);
+	for (; i_action < num_actions; i_action++)
+	{
+		const float action_regret = cumulative_regret[i_action] > 0 ? cumulative_regret[i_action] : 0.0f;
+		strategy[i_action] = action_regret;
+		regret_sum += action_regret;
+	}
+	NormalizeStrategySse2(strategy, regret_sum, num_actions, 0);
+}
+
+static void AccumulateRegretsSse2(
+	float* cumulative_regret, const float* utilities, float val, float weight, int num_actions
+) {
+	const __m128 val_v = _mm_set1_ps(val);
+	const __m128 weight_v = _mm_set1_ps(weight);
+	int i_action = 0;
+	for (; i_action + 4 <= num_actions; i_action += 4)
+	{
+		const __m128 regret = _mm_mul_ps(weight_v, _mm_sub_ps(_mm_loadu_ps(utilities + i_action), val_v));
+		_mm_storeu_ps(cumulative_regret + i_action, _mm_add_ps(_mm_loadu_ps(cumulative_regret + i_action), regret));
+	}
+	CfrKernels::AccumulateRegretsScalar(cumulative_regret + i_action, utilities + i_action, val, weight, num_actions - i_action);
+}
+
+static void AccumulateStrategySse2(
+	float* cumulative_strategy, const float* strategy, float weight, int num_actions
+) {
+	const __m128 weight_v = _mm_set1_ps(weight);
+	int i_action = 0;
+	for (; i_action + 4 <= num_actions; i_action += 4)
+	{
+		const __m128 prob = _mm_mul_ps(weight_v, _mm_loadu_ps(strategy + i_action));
+		_mm_storeu_ps(cumulative_strategy + i_action, _mm_add_ps(_mm_loadu_ps(cumulative_strategy + i_action), prob));
+	}
+	CfrKernels::AccumulateStrategyScalar(cumulative_strategy + i_action, strategy + i_action, weight, num_actions - i_action);
+}
+
+/* ### AVX2 ### */
+
+//Multiplies and adds are kept separate rather than fused, so every version rounds alike.
+//The upper halves of the YMM registers are cleared before handing the tail to SSE2 code,
+//which would otherwise pay an AVX to SSE transition on every call.
+CFR_TARGET("avx2")
+static void RegretMatchingAvx2(const float* cumulative_regret, float* strategy, int num_actions)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 sum = zero;
+	int i_action = 0;
+	for (; i_action + 8 <= num_actions; i_action += 8)
+	{
+		const __m256 positive_regret = _mm256_max_ps(_mm256_loadu_ps(cumulative_regret + i_action), zero);
+		_mm256_storeu_ps(strategy + i_action, positive_regret);
+		sum = _mm256_add_ps(sum, positive_regret);
+	}
+	__m128 sum_half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	_mm256_zeroupper();
+	if (i_action + 4 <= num_actions)
+	{
+		const __m128 positive_regret = _mm_max_ps(_mm_loadu_ps(cumulative_regret + i_action), _mm_setzero_ps());
+		_mm_storeu_ps(strategy + i_action, positive_regret);
+		sum_half = _mm_add_ps(sum_half, positive_regret);
+		i_action += 4;
+	}
+	float regret_sum = HorizontalSum(sum_half);
+	for (; i_action < num_actions; i_action++)
+	{
+		const float action_regret = cumulative_regret[i_action] > 0 ? cumulative_regret[i_action] : 0.0f;
+		strategy[i_action] = action_regret;
+		regret_sum += action_regret;
+	}
+	i_action = 0;
+	if (regret_sum > 0)
+	{
+		const __m256 sum_v = _mm256_set1_ps(regret_sum);
+		for (; i_action + 8 <= num_actions; i_action += 8)
+		{
+			_mm256_storeu_ps(strategy + i_action, _mm256_div_ps(_mm256_loadu_ps(strategy + i_action), sum_v));
+		}
+		_mm256_zeroupper();
+	}
+	NormalizeStrategySse2(strategy, regret_sum, num_actions, i_action);
+}
+
+CFR_TARGET("avx2")
+static void AccumulateRegretsAvx2(
+	float* cumulative_regret, const float* utilities, float val, float weight, int num_actions
+) {
+	const __m256 val_v = _mm256_set1_ps(val);
+	const __m256 weight_v = _mm256_set1_ps(weight);
+	int i_action = 0;
+	for (; i_action + 8 <= num_actions; i_action += 8)
+	{
+		const __m256 regret = _mm256_mul_ps(weight_v, _mm256_sub_ps(_mm256_loadu_ps(utilities + i_action), val_v));
+		_mm256_storeu_ps(cumulative_regret + i_action, _mm256_add_ps(_mm256_loadu_ps(cumulative_regret + i_action), regret));
+	}
+	_mm256_zeroupper();
+	AccumulateRegretsSse2(cumulative_regret + i_action, utilities + i_action, val, weight, num_actions - i_action);
+}
+
+CFR_TARGET("avx2")
+static void AccumulateStrategyAvx2(
+	float* cumulative_strategy, const float* strategy, float weight, int num_actions
+) {
+	const __m256 weight_v = _mm256_set1_ps(weight);
+	int i_action = 0;
+	for (; i_action + 8 <= num_actions; i_action += 8)
+	{
+		const __m256 prob = _mm256_mul_ps(weight_v, _mm256_loadu_ps(strategy + i_action));
+		_mm256_storeu_ps(cumulative_strategy + i_action, _mm256_add_ps(_mm256_loadu_ps(cumulative_strategy + i_action), prob));
+	}
+	_mm256_zeroupper();
+	AccumulateStrategySse2(cumulative_strategy + i_action, strategy + i_action, weight, num_actions - i_action);
+}
+
+#if defined(_MSC_VER)
+CFR_TARGET("xsave")
+static bool CpuSupportsAvx2()
+{
+	int cpu_info[4];
+	__cpuid(cpu_info, 0);
+	if (cpu_info[0] < 7) {
+		return false;
+	}
+	//The processor must support AVX and XSAVE, and the OS must save the YMM registers.
+	__cpuid(cpu_info, 1);
+	const int kOsxsave = 1 << 27;
+	const int kAvx = 1 << 28;
+	if (( cpu_info[2] & ( kOsxsave | kAvx ) ) != ( kOsxsave | kAvx )) {
+		return false;
+	}
+	if (( _xgetbv(0) & 6 ) != 6) {
+		return false;
+	}
+	__cpuidex(cpu_info, 7, 0);
+	const int kAvx2 = 1 << 5;
+	return ( cpu_info[1] & kAvx2 ) != 0;
+}
+#else
+static bool CpuSupportsAvx2()
+{
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#endif
+
+/* ### Dispatch ### */
+
+CfrKernels::KernelTable CfrKernels::MakeKernelTable(InstructionSet instruction_set)
+{
+#ifdef CFR_KERNELS_X86
+	if (instruction_set == InstructionSet::kAvx2) {
+		return { instruction_set, RegretMatchingAvx2, AccumulateRegretsAvx2, AccumulateStrategyAvx2 };
+	}
+	if (instruction_set == InstructionSet::kSse2) {
+		return { instruction_set, RegretMatchingSse2, AccumulateRegretsSse2, AccumulateStrategySse2 };
+	}
+#endif
+	return { InstructionSet::kScalar, RegretMatchingScalar, AccumulateRegretsScalar, AccumulateStrategyScalar };
+}
+
+CfrKernels::KernelTable CfrKernels::kernels_ = CfrKernels::MakeKernelTable(CfrKernels::Supported());
+
+CfrKernels::InstructionSet CfrKernels::Supported()
+{
+#ifdef CFR_KERNELS_X86
+	static const bool has_avx2 = CpuSupportsAvx2();
+	//SSE2 is part of x86-64, and MSVC has targeted it by default on x86 since VS2012.
+	return has_avx2 ? InstructionSet::kAvx2 : InstructionSet::kSse2;
+#else
+	return InstructionSet::kScalar;
+#endif
+}
+
+CfrKernels::InstructionSet CfrKernels::Selected()
+{
+	return kernels_.instruction_set;
+}
+
+CfrKernels::InstructionSet CfrKernels::Select(InstructionSet instruction_set)
+{
+	if (static_cast<int>(instruction_set) > static_cast<int>(Supported())) {
+		instruction_set = Supported();
+	}
+	kernels_ = MakeKernelTable(instruction_set);
+	return instruction_set;
+}
+
+const char* CfrKernels::Name(InstructionSet instruction_set)
+{
+	switch (instruction_set) {
+	case InstructionSet::kAvx2:
+		return "AVX2";
+	case InstructionSet::kSse2:
+		return "SSE2";
+	default:
+		return "scalar";
+	}
+}
@@ -0,0 +1,263 @@
+#pragma once
+#include "pch.h"
+#include "framework.h"
+#include <cfloat>
+
+
+/**
+ * @brief Regret matching and regret / strategy accumulation over the action arrays
+ *		  of an info set. Each kernel has a scalar, an SSE2 and an AVX2 version; the
+ *		  widest one the processor supports is selected as the program starts, and
+ *		  calls for at least kMinVectorActions actions go through its function pointer.
+ *		  Calls for fewer actions than fill a vector run the scalar version inline.
+ *		  The kernels read and write the arrays as plain floats, so they are only used
+ *		  by walks that no other thread updates the info sets during; solvers sharing
+ *		  the regret table go through the relaxed accessors of InfoSetData instead.
+ *		  Arrays need no alignment beyond that of float.
+ */
+class CfrKernels {
+public:
+
+	enum class InstructionSet {
+		kScalar,
+		kSse2,
+		kAvx2
+	};
+
+	/**
+	 * @brief Fewest actions the dispatched vector kernels are called for, the width of
+	 *		  an SSE2 vector.
+	 */
+	static const int kMinVectorActions = 4;
+
+	/**
+	 * @brief Sets strategy to the positive part of cumulative_regret, normalized to
+	 *		  sum to one, or to the uniform strategy when no regret is positive.
+	 */
+	static void RegretMatching(const float* cumulative_regret, float* strategy, int num_actions);
+
+	/**
+	 * @brief Adds weight * ( utilities[i] - val ) to cumulative_regret[i].
+	 */
+	static void AccumulateRegrets(
+		float* cumulative_regret, const float* utilities, float val, float weight, int num_actions
+	);
+
+	/**
+	 * @brief Adds weight * strategy[i] to cumulative_strategy[i].
+	 */
+	static void AccumulateStrategy(
+		float* cumulative_strategy, const float* strategy, float weight, int num_actions
+	);
+
+	/**
+	 * @return Largest relative difference between the probabilities of two regret
+	 *		   matching kernels. Summing n non-negative floats in any order is within
+	 *		   ( n - 1 ) / 2 FLT_EPSILON of the exact sum, and each division adds half
+	 *		   an FLT_EPSILON, so two orders differ by less than n FLT_EPSILON.
+	 */
+	static constexpr float RegretMatchingTolerance(int num_actions) {
+		return static_cast<float>(num_actions) * FLT_EPSILON;
+	}
+
+	/**
+	 * @return Widest instruction set supported by the processor.
+	 */
+	static InstructionSet Supported();
+
+	/**
+	 * @return Instruction set of the kernels currently in use.
+	 */
+	static InstructionSet Selected();
+
+	/**
+	 * @brief Switches every kernel to the given instruction set, or to the widest
+	 *		  supported one if the processor lacks it. Meant for benchmarks and for
+	 *		  checking the vector kernels against the scalar ones, not to be called
+	 *		  while a solver is running.
+	 * @return Instruction set actually selected.
+	 */
+	static InstructionSet Select(InstructionSet instruction_set);
+
+	static const char* Name(InstructionSet instruction_set);
+
+	/**
+	 * @brief Scalar kernels for info sets of at most kMaxActions actions, inlined at the
+	 *		  call site with loops the compiler unrolls fully. For the few actions of small
+	 *		  games they beat the dispatched kernels, which pay for an indirect call and
+	 *		  vector tails. They add in the scalar kernels' order, so results match them
+	 *		  bit for bit. Like the dispatched kernels, they write plainly, so only
+	 *		  single-threaded walks use them.
+	 */
+	template<int kMaxActions>
+	static void RegretMatchingUnrolled(const float* cumulative_regret, float* strategy, int num_actions);
+
+	template<int kMaxActions>
+	static void AccumulateRegretsUnrolled(
+		float* cumulative_regret, const float* utilities, float val, float weight, int num_actions
+	);
+
+	template<int kMaxActions>
+	static void AccumulateStrategyUnrolled(
+		float* cumulative_strategy, const float* strategy, float weight, int num_actions
+	);
+
+	/**
+	 * @brief Scalar kernels, also used for the tails of the vector kernels. The vector
+	 *		  accumulation kernels match them bit for bit. Vector regret matching sums the
+	 *		  positive regrets in separate lanes, a different order, so its probabilities
+	 *		  differ from these within RegretMatchingTolerance.
+	 */
+	static void RegretMatchingScalar(const float* cumulative_regret, float* strategy, int num_actions);
+
+	static void AccumulateRegretsScalar(
+		float* cumulative_regret, const float* utilities, float val, float weight, int num_actions
+	);
+
+	static void AccumulateStrategyScalar(
+		float* cumulative_strategy, const float* strategy, float weight, int num_actions
+	);
+
+private:
+
+	struct KernelTable {
+		InstructionSet instruction_set;
+		void (*regret_matching)(const float*, float*, int);
+		void (*accumulate_regrets)(float*, const float*, float, float, int);
+		void (*accumulate_strategy)(float*, const float*, float, int);
+	};
+
+	static KernelTable MakeKernelTable(InstructionSet instruction_set);
+
+	//Kernels in use, initialized with the program's statics rather than on first call.
+	static KernelTable kernels_;
+};
+
+
+inline void CfrKernels::RegretMatching(const float* cumulative_regret, float* strategy, int num_actions)
+{
+	if (num_actions < kMinVectorActions)
+	{
+		RegretMatchingScalar(cumulative_regret, strategy, num_actions);
+		return;
+	}
+	kernels_.regret_matching(cumulative_regret, strategy, num_actions);
+}
+
+inline void CfrKernels::AccumulateRegrets(
+	float* cumulative_regret, const float* utilities, float val, float weight, int num_actions
+) {
+	if (num_actions < kMinVectorActions)
+	{
+		AccumulateRegretsScalar(cumulative_regret, utilities, val, weight, num_actions);
+		return;
+	}
+	kernels_.accumulate_regrets(cumulative_regret, utilities, val, weight, num_actions);
+}
+
+inline void CfrKernels::AccumulateStrategy(
+	float* cumulative_strategy, const float* strategy, float weight, int num_actions
+) {
+	if (num_actions < kMinVectorActions)
+	{
+		AccumulateStrategyScalar(cumulative_strategy, strategy, weight, num_actions);
+		return;
+	}
+	kernels_.accumulate_strategy(cumulative_strategy, strategy, weight, num_actions);
+}
+
+inline void CfrKernels::RegretMatchingScalar(const float* cumulative_regret, float* strategy, int num_actions)
+{
+	float regret_sum = 0;
+	for (int i_action = 0; i_action < num_actions; i_action++)
+	{
+		float action_regret = cumulative_regret[i_action];
+		if (action_regret > 0)
+		{
+			strategy[i_action] = action_regret;
+			regret_sum += action_regret;
+		}
+		else
+		{
+			strategy[i_action] = 0.0;
+		}
+	}
+	const float uniform_prob = 1.0 / static_cast<float>(num_actions);
+	for (int i_action = 0; i_action < num_actions; i_action++)
+	{
+		if (regret_sum > 0)
+		{
+			strategy[i_action] = strategy[i_action] / regret_sum;
+		}
+		else
+		{
+			strategy[i_action] = uniform_prob;
+		}
+	}
+}
+
+inline void CfrKernels::AccumulateRegretsScalar(
+	float* cumulative_regret, const float* utilities, float val, float weight, int num_actions
+) {
+	for (int i_action = 0; i_action < num_actions; i_action++)
+	{
+		cumulative_regret[i_action] += weight * ( utilities[i_action] - val );
+	}
+}
+
+inline void CfrKernels::AccumulateStrategyScalar(
+	float* cumulative_strategy, const float* strategy, float weight, int num_actions
+) {
+	for (int i_action = 0; i_action < num_actions; i_action++)
+	{
+		cumulative_strategy[i_action] += weight * strategy[i_action];
+	}
+}
+
+
+template<int kMaxActions>
+inline void CfrKernels::RegretMatchingUnrolled(const float* cumulative_regret, float* strategy, int num_actions)
+{
+	float positive_regrets[kMaxActions];
+	float regret_sum = 0;
+	for (int i_action = 0; i_action < kMaxActions; i_action++)
+	{
+		const float action_regret = i_action < num_actions ? cumulative_regret[i_action] : 0.0f;
+		positive_regrets[i_action] = action_regret > 0 ? action_regret : 0.0f;
+		regret_sum += positive_regrets[i_action];
+	}
+	const float uniform_prob = 1.0 / static_cast<float>(num_actions);
+	for (int i_action = 0; i_action < kMaxActions; i_action++)
+	{
+		if (i_action < num_actions)
+		{
+			strategy[i_action] = regret_sum > 0 ? positive_regrets[i_action] / regret_sum : uniform_prob;
+		}
+	}
+}
+
+template<int kMaxActions>
+inline void CfrKernels::AccumulateRegretsUnrolled(
+	float* cumulative_regret, const float* utilities, float val, float weight, int num_actions
+) {
+	for (int i_action = 0; i_action < kMaxActions; i_action++)
+	{
+		if (i_action < num_actions)
+		{
+			cumulative_regret[i_action] += weight * ( utilities[i_action] - val );
+		}
+	}
+}
+
+template<int kMaxActions>
+inline void CfrKernels::AccumulateStrategyUnrolled(
+	float* cumulative_strategy, const float* strategy, float weight, int num_actions
+) {
+	for (int i_action = 0; i_action < kMaxActions; i_action++)
+	{
+		if (i_action < num_actions)
+		{
+			cumulative_strategy[i_action] += weight * strategy[i_action];
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "pch.h"
+#include "framework.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Bump allocator for the nodes created while constructing the search tree,
+ *		  with one arena per depth. Nodes are built in blocks of kNodesPerBlock, so
+ *		  creating a node rarely allocates, and memory is only released in bulk when
+ *		  the arena is destroyed.
+ *		  A depth can be rewound to an earlier mark, destroying the nodes created since
+ *		  along with every node below that depth, so a depth first build reuses the
+ *		  same few slots for every sibling subtree.
+ *		  An arena is not thread safe, each thread building nodes needs its own.
+ */
+template<typename Node>
+class DepthArena {
+
+	static const int kNodesPerBlock = 64;
+
+	struct alignas(Node) Slot {
+		std::byte bytes[sizeof(Node)];
+	};
+
+	/**
+	 * @brief Blocks of a single depth, and the number of nodes alive in them.
+	 */
+	struct DepthBlocks {
+		std::vector<std::unique_ptr<Slot[]>> blocks;
+		long long num_nodes = 0;
+	};
+
+	std::vector<DepthBlocks> depths_;
+
+public:
+
+	DepthArena() = default;
+	DepthArena(DepthArena&&) = default;
+	DepthArena(const DepthArena&) = delete;
+	DepthArena& operator=(const DepthArena&) = delete;
+
+	~DepthArena()
+	{
+		for (DepthBlocks& depth_blocks : depths_) {
+			DestroyNodes(depth_blocks, 0);
+		}
+	}
+
+	/**
+	 * @brief Constructs a node at the given depth from args.
+	 * @return Pointer to the node, valid until its depth is rewound past it.
+	 */
+	template<typename... Args>
+	Node* Create(int depth, Args&&... args)
+	{
+		while (static_cast<int>(depths_.size()) <= depth) {
+			depths_.emplace_back();
+		}
+		DepthBlocks& depth_blocks = depths_[depth];
+		const std::size_t i_block = static_cast<std::size_t>(depth_blocks.num_nodes / kNodesPerBlock);
+		if (i_block == depth_blocks.blocks.size()) {
+			depth_blocks.blocks.push_back(std::make_unique<Slot[]>(kNodesPerBlock));
+		}
+		Slot& slot = depth_blocks.blocks[i_block][depth_blocks.num_nodes % kNodesPerBlock];
+		Node* node = ::new (static_cast<void*>(slot.bytes)) Node(std::forward<Args>(args)...);
+		depth_blocks.num_nodes++;
+		return node;
+	}
+
+	/**
+	 * @return Mark of the next node created at the given depth.
+	 */
+	long long Mark(int depth) const
+	{
+		return depth < static_cast<int>(depths_.size()) ? depths_[depth].num_nodes : 0;
+	}
+
+	/**
+	 * @brief Destroys every node created at the given depth since mark, and every
+	 *		  node at deeper depths, keeping their memory for the nodes created next.
+	 */
+	void Rewind(int depth, long long mark)
+	{
+		//Deeper nodes are only created below live nodes, so the first empty depth ends them.
+		for (int i_depth = depth; i_depth < static_cast<int>(depths_.size()); i_depth++) {
+			DepthBlocks& depth_blocks = depths_[i_depth];
+			const long long depth_mark = i_depth == depth ? mark : 0;
+			if (depth_blocks.num_nodes <= depth_mark) {
+				return;
+			}
+			DestroyNodes(depth_blocks, depth_mark);
+		}
+	}
+
+private:
+
+	static void DestroyNodes(DepthBlocks& depth_blocks, long long mark)
+	{
+		while (depth_blocks.num_nodes > mark) {
+			depth_blocks.num_nodes--;
+			Slot& slot = depth_blocks.blocks[depth_blocks.num_nodes / kNodesPerBlock][depth_blocks.num_nodes % kNodesPerBlock];
+			std::destroy_at(std::launder(reinterpret_cast<Node*>(slot.bytes)));
+		}
+	}
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include "pch.h"
+#include "framework.h"
+#include <concepts>
+
+
+/**
+ * @brief How the walks of CfrTree treat chance nodes.
+ *		  kPerCall leaves the choice to each solver method: CFR walks every child of a
+ *		  chance node, while the MCCFR methods sample one.
+ *		  kFull and kChanceSampled fix the choice for every method, compiling the other
+ *		  branch out of the walks. CFR_LevelSynchronous and CFR_TaskParallel index every
+ *		  node of the tree up front, and always walk every child.
+ */
+enum class CfrSampling {
+	kPerCall,
+	kFull,
+	kChanceSampled
+};
+
+/**
+ * @brief How cumulative regrets are updated after each visit.
+ *		  kRegretMatching keeps every regret as summed.
+ *		  kRegretMatchingPlus floors each cumulative regret at zero, as in CFR+, so an
+ *		  action that starts paying off again is played again straight away.
+ */
+enum class CfrUpdateRule {
+	kRegretMatching,
+	kRegretMatchingPlus
+};
+
+/**
+ * @brief When walks regret match the current strategy of the info sets they update.
+ *		  kPerVisit matches an info set as soon as a visit updates its regrets, so its
+ *		  nodes walked later in the same pass already play the new strategy.
+ *		  kPerPass matches every info set once after each player's pass, so all nodes
+ *		  of an info set play one strategy per pass. CFR_LevelSynchronous always updates
+ *		  this way, so under kPerPass CFR computes the same iterations it does. Info sets
+ *		  of InfoSetLayout::kDerivedStrategy derive their strategy whenever it is read,
+ *		  and so play the new strategy straight away under either timing.
+ *		  Matching the whole table costs a pass over it, so kPerPass is only for the
+ *		  full walks of CFR, CFR_ToAccuracy and CFR_TaskParallel. The MCCFR methods,
+ *		  and CFR under CfrSampling::kChanceSampled, fail to compile with it.
+ */
+enum class CfrMatchTiming {
+	kPerVisit,
+	kPerPass
+};
+
+/**
+ * @brief Compile time configuration of a CfrTree.
+ * @tparam kSamplingScheme How chance nodes are walked.
+ * @tparam kRule How cumulative regrets are updated.
+ * @tparam WalkValueType Floating point type every CFR and MCCFR walk carries reach
+ *		   probabilities and node values in. It does not set the precision of the
+ *		   cumulative regrets and strategy: those keep the precision the regret table
+ *		   was constructed with, and each visit's update is rounded to float before it
+ *		   is added to them.
+ * @tparam kTiming When current strategies are regret matched.
+ */
+template<
+	CfrSampling kSamplingScheme = CfrSampling::kPerCall,
+	CfrUpdateRule kRule = CfrUpdateRule::kRegretMatching,
+	typename WalkValueType = float,
+	CfrMatchTiming kTiming = CfrMatchTiming::kPerVisit
+>
+struct CfrPolicy {
+	static constexpr CfrSampling kSampling = kSamplingScheme;
+	static constexpr CfrUpdateRule kUpdateRule = kRule;
+	using WalkValue = WalkValueType;
+	static constexpr CfrMatchTiming kMatchTiming = kTiming;
+};
+
+/**
+ * @brief Policy of a CfrTree given none, matching the solver methods as documented.
+ */
+using DefaultCfrPolicy = CfrPolicy<>;
+
+/**
+ * @brief Requirements for a policy of the generic cfr tree.
+ */
+template<typename Policy>
+concept CfrPolicyRequirements =
+	requires {
+		{ Policy::kSampling } -> std::convertible_to<CfrSampling>;
+		{ Policy::kUpdateRule } -> std::convertible_to<CfrUpdateRule>;
+		{ Policy::kMatchTiming } -> std::convertible_to<CfrMatchTiming>;
+	} &&
+	std::floating_point<typename Policy::WalkValue>;
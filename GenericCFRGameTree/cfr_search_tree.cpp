@@ -1,35 +1,55 @@
 #include "pch.h"
 #include "framework.h"
 #include "cfr_tree_nodes.h"
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
 
 
 
+/**
+ * @brief Sets the header of a player or chance node, and its children offset.
+ * @return Address just past the children offset.
+ */
+static TreeUtils::Byte* SetNodeHeader(
+	TreeUtils::Byte* tree_pos, char identifier, bool is_player_one,
+	int num_children, std::uint32_t children_offset
+) {
+	const int header_size = TreeUtils::HeaderSize(num_children);
+	std::memset(tree_pos, 0, header_size);
+	tree_pos[0] = identifier;
+	tree_pos[TreeUtils::kPlayerOneOffset] = is_player_one;
+	TreeUtils::Byte* count_pos = tree_pos + TreeUtils::kChildCountOffset;
+	std::uint32_t count = static_cast<std::uint32_t>(num_children);
+	while (count >= 0x80) {
+		*count_pos++ = static_cast<TreeUtils::Byte>(( count & 0x7F ) | 0x80);
+		count >>= 7;
+	}
+	*count_pos = static_cast<TreeUtils::Byte>(count);
+	std::memcpy(tree_pos + header_size, &children_offset, TreeUtils::kChildrenOffsetSize);
+	return tree_pos + header_size + TreeUtils::kChildrenOffsetSize;
+}
+
 TreeUtils::Byte* TreeUtils::SetPlayerNode
 (
-	Byte* tree_pos, const int num_children, Byte* children_start,
+	Byte* tree_pos, const int num_children, std::uint32_t children_offset,
 	bool is_player_one, Byte* info_set_pointer
 ) 
 {
-	Byte* temp = tree_pos;
-	*(temp++) = (char) 'p';
-	*(temp++) = static_cast<uint8_t>(num_children);
-	TreeUtils::SetBytePtrAtBytePtr(temp, children_start);
-	temp += sizeof(Byte*);
-	*(temp++) = (bool) is_player_one;
-	TreeUtils::SetBytePtrAtBytePtr(temp, info_set_pointer);
-	temp += sizeof(Byte*);
-	return temp;
+	Byte* info_set_pos = SetNodeHeader(tree_pos, 'p', is_player_one, num_children, children_offset);
+	TreeUtils::SetBytePtrAtBytePtr(info_set_pos, info_set_pointer);
+	return info_set_pos + sizeof(Byte*);
 }
 
 TreeUtils::Byte* TreeUtils::SetChanceNode(
-	Byte* tree_pos, Byte* children_start,
+	Byte* tree_pos, std::uint32_t children_offset,
 	const std::vector<float>& child_probs
 ) {
-	Byte* temp = tree_pos;
-	*( temp++ ) = (char) 'c';
-	*( temp++ ) = static_cast<uint8_t>(child_probs.size());
-	TreeUtils::SetBytePtrAtBytePtr(temp, children_start);
-	temp += sizeof(Byte*);
+	Byte* temp = SetNodeHeader(tree_pos, 'c', false, static_cast<int>(child_probs.size()), children_offset);
 	for (float prob : child_probs) {
 		TreeUtils::SetFloatAtBytePtr(temp, prob);
 		temp += sizeof(float);
@@ -38,38 +58,102 @@ TreeUtils::Byte* TreeUtils::SetChanceNode(
 }
 
 TreeUtils::Byte* TreeUtils::SetTerminalNode(Byte* tree_pos, const float utility) {
-	Byte* temp = tree_pos;
-	*( temp++ ) = (char) 't';
-	TreeUtils::SetFloatAtBytePtr(temp, utility);
-	temp += sizeof(float);
-	return temp;
+	std::memset(tree_pos, 0, kUtilityOffset);
+	tree_pos[0] = (char) 't';
+	TreeUtils::SetFloatAtBytePtr(tree_pos + kUtilityOffset, utility);
+	return tree_pos + kTerminalSize;
+}
+
+int TreeUtils::ChildCountAt(const Byte* tree_pos)
+{
+	const Byte* count_pos = tree_pos + kChildCountOffset;
+	std::uint32_t count = 0;
+	int shift = 0;
+	while (*count_pos & 0x80) {
+		count |= static_cast<std::uint32_t>(*count_pos & 0x7F) << shift;
+		shift += 7;
+		count_pos++;
+	}
+	return static_cast<int>(count | ( static_cast<std::uint32_t>(*count_pos) << shift ));
+}
+
+int TreeUtils::NodeSizeAt(const Byte* tree_pos)
+{
+	if (tree_pos[0] == 'p') {
+		return PlayerNodeSizeInTree(ChildCountAt(tree_pos));
+	}
+	if (tree_pos[0] == 'c') {
+		return ChanceNodeSizeInTree(ChildCountAt(tree_pos));
+	}
+	return kTerminalSize;
+}
+
+std::uint32_t TreeUtils::CheckedChildrenOffset(long long children_offset)
+{
+	if (children_offset < 0 || children_offset > static_cast<long long>(std::numeric_limits<std::uint32_t>::max())) {
+		throw std::length_error("Children offset of " + std::to_string(children_offset)
+			+ " bytes does not fit in 32 bits");
+	}
+	return static_cast<std::uint32_t>(children_offset);
+}
+
+void TreeUtils::SetChildrenStart(Byte* tree_pos, Byte* children_start)
+{
+	SetChildrenOffset(tree_pos, CheckedChildrenOffset(children_start - tree_pos));
+}
+
+void TreeUtils::SetChildrenOffset(Byte* tree_pos, std::uint32_t children_offset)
+{
+	std::memcpy(tree_pos + HeaderSize(ChildCountAt(tree_pos)), &children_offset, kChildrenOffsetSize);
+}
+
+std::uint32_t TreeUtils::ChildrenOffsetAt(const Byte* tree_pos)
+{
+	std::uint32_t children_offset;
+	std::memcpy(&children_offset, tree_pos + HeaderSize(ChildCountAt(tree_pos)), kChildrenOffsetSize);
+	return children_offset;
+}
+
+void TreeUtils::SetInfoSetPosition(Byte* tree_pos, Byte* info_set_pointer)
+{
+	const int info_set_offset = HeaderSize(ChildCountAt(tree_pos)) + kChildrenOffsetSize;
+	TreeUtils::SetBytePtrAtBytePtr(tree_pos + info_set_offset, info_set_pointer);
 }
 
 using Byte = unsigned char;
 
 SearchTreeNode::SearchTreeNode(Byte* pos) {
-	const TreeUtils::Byte* initialPos = pos;
-	this->identifier_ = static_cast<char>(*(pos++));
-	if (this->identifier_ == 'p' || this->identifier_ == 'c') {
-		this->num_children_ = (uint8_t) *( pos++ );
-		this->p_child_start_offset_ = TreeUtils::GetBytePtrAtBytePtr(pos);
-		pos += sizeof(Byte*);
+	this->identifier_ = static_cast<char>(pos[0]);
+	if (this->identifier_ == 't') {
+		this->utility_ = TreeUtils::GetFloatFromBytePtr(pos + TreeUtils::kUtilityOffset);
+		size_in_tree_ = TreeUtils::kTerminalSize;
+		p_next_node_ = pos + size_in_tree_;
+		return;
 	}
-	if (this->identifier_ == 'p') {
-		this->is_player_one_ = static_cast<bool>(*pos++);
-		this->p_info_set_ptr_ = TreeUtils::GetBytePtrAtBytePtr(pos);
-		pos += sizeof(Byte*);
+	//Single byte counts are by far the most common, so they skip the varint decode.
+	const Byte count_byte = pos[TreeUtils::kChildCountOffset];
+	Byte* children_offset_pos = pos + TreeUtils::kRecordAlignment;
+	if (count_byte < 0x80) {
+		this->num_children_ = count_byte;
 	}
-	if (this->identifier_ == 'c') {
-		this->p_child_probs_ = pos;
-		pos += (this->num_children_ * sizeof(float));
+	else {
+		this->num_children_ = TreeUtils::ChildCountAt(pos);
+		children_offset_pos = pos + TreeUtils::HeaderSize(this->num_children_);
 	}
-	if (this->identifier_ == 't') {
-		this->utility_ = TreeUtils::GetFloatFromBytePtr(pos);
-		pos += sizeof(float);
+	std::uint32_t children_offset;
+	std::memcpy(&children_offset, children_offset_pos, TreeUtils::kChildrenOffsetSize);
+	this->p_child_start_offset_ = pos + children_offset;
+	Byte* data_pos = children_offset_pos + TreeUtils::kChildrenOffsetSize;
+	if (this->identifier_ == 'p') {
+		this->is_player_one_ = static_cast<bool>(pos[TreeUtils::kPlayerOneOffset]);
+		this->p_info_set_ptr_ = TreeUtils::GetBytePtrAtBytePtr(data_pos);
+		size_in_tree_ = static_cast<int>(data_pos - pos) + static_cast<int>(sizeof(Byte*));
 	}
-	p_next_node_ = pos;
-	size_in_tree_ = static_cast<int>(pos - initialPos);
+	else {
+		this->p_child_probs_ = data_pos;
+		size_in_tree_ = static_cast<int>(data_pos - pos) + this->num_children_ * static_cast<int>(sizeof(float));
+	}
+	p_next_node_ = pos + size_in_tree_;
 
 }
 
@@ -82,7 +166,7 @@ bool SearchTreeNode::IsChanceNode() const
 bool SearchTreeNode::IsTerminalNode() const
 { return this->identifier_ == 't'; }
 
-uint8_t SearchTreeNode::NumChildren() const
+int SearchTreeNode::NumChildren() const
 { return this->num_children_; }
 
 Byte* SearchTreeNode::ChildrenStartOffset() const
@@ -107,6 +191,19 @@ std::vector<float> SearchTreeNode::ChildProbabilities() const
 	return probabilities;
 }
 
+std::span<const float> SearchTreeNode::ChildProbabilitySpan() const
+{
+	if (!this->IsChanceNode()) {
+		return {};
+	}
+	return { reinterpret_cast<const float*>( this->p_child_probs_ ), static_cast<std::size_t>(this->num_children_) };
+}
+
+float SearchTreeNode::ChildProbability(int index) const
+{
+	return TreeUtils::GetFloatFromBytePtr(this->p_child_probs_ + ( sizeof(float) * index ));
+}
+
 std::vector<float> SearchTreeNode::CumulativeChildProbs() const
 {
 	std::vector<float> probs;
@@ -126,23 +223,24 @@ std::vector<float> SearchTreeNode::CumulativeChildProbs() const
 
 SearchTreeNode SearchTreeNode::SampleChild() const
 {
-	if (this->num_children_ == 1)
-	{
-		return SearchTreeNode{this->p_child_start_offset_};
-	}
 	float rand_float = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
+	return SampleChild(rand_float);
+}
+
+SearchTreeNode SearchTreeNode::SampleChild(float rand_float) const
+{
+	Byte* child_pos = this->p_child_start_offset_;
 	float cumulative_prob = 0;
-	int child_index = 0;
 	Byte* childProbPos = this->p_child_probs_;
-	for (child_index; child_index < this->num_children_; child_index++)
+	//Walk siblings until the cumulative probability passes the sampled value.
+	for (int child_index = 0; child_index < this->num_children_ - 1; child_index++)
 	{
-		if (rand_float > cumulative_prob) {break;}
 		cumulative_prob += TreeUtils::GetFloatFromBytePtr(childProbPos);
 		childProbPos += sizeof(float);
-
+		if (rand_float < cumulative_prob) { break; }
+		child_pos += TreeUtils::NodeSizeAt(child_pos);
 	}
-	std::vector<SearchTreeNode> children = this->AllChildren();
-	return children.at(child_index);
+	return SearchTreeNode{ child_pos };
 }
 
 float SearchTreeNode::Utility() const
@@ -171,9 +269,321 @@ std::vector<SearchTreeNode> SearchTreeNode::AllChildren() const
 	return children;
 }
 
+ChildRange SearchTreeNode::Children() const
+{
+	return ChildRange(this->p_child_start_offset_, this->num_children_);
+}
+
 int SearchTreeNode::SizeInTree() const
 { return this->size_in_tree_; }
 
+TreeLevelIndex::TreeLevelIndex(Byte* root)
+{
+	node_positions_.push_back(root);
+	level_starts_.push_back(0);
+
+	//Children of each level are appended in parent order, forming the next level.
+	long long level_start = 0;
+	while (level_start < NumNodes()) {
+		const long long level_end = NumNodes();
+		level_starts_.push_back(level_end);
+		for (long long i_node = level_start; i_node < level_end; i_node++) {
+			SearchTreeNode node{ node_positions_[i_node] };
+			first_child_.push_back(NumNodes());
+			if (node.IsTerminalNode()) {
+				continue;
+			}
+			Byte* child_pos = node.ChildrenStartOffset();
+			for (int i_child = 0; i_child < node.NumChildren(); i_child++) {
+				node_positions_.push_back(child_pos);
+				child_pos = SearchTreeNode{ child_pos }.NextNodePos();
+			}
+		}
+		level_start = level_end;
+	}
+
+	//Children always follow their parent, so sizes can be summed back to front.
+	subtree_sizes_.assign(NumNodes(), 1);
+	for (long long i_node = NumNodes() - 1; i_node >= 0; i_node--) {
+		const long long first_child = first_child_[i_node];
+		const long long last_child = i_node + 1 < NumNodes() ? first_child_[i_node + 1] : NumNodes();
+		for (long long i_child = first_child; i_child < last_child; i_child++) {
+			subtree_sizes_[i_node] += subtree_sizes_[i_child];
+		}
+	}
+
+	//Group player nodes by info set, in order of first appearance.
+	std::unordered_map<Byte*, long long> info_set_indices;
+	std::vector<std::vector<long long>> nodes_per_info_set;
+	for (long long i_node = 0; i_node < NumNodes(); i_node++) {
+		SearchTreeNode node{ node_positions_[i_node] };
+		if (!node.IsPlayerNode()) {
+			continue;
+		}
+		auto [it, inserted] = info_set_indices.insert({ node.InfoSetPosition(), NumInfoSets() });
+		if (inserted) {
+			info_sets_.push_back(node.InfoSetPosition());
+			nodes_per_info_set.emplace_back();
+		}
+		nodes_per_info_set[it->second].push_back(i_node);
+	}
+	info_set_node_starts_.push_back(0);
+	for (const std::vector<long long>& info_set_nodes : nodes_per_info_set) {
+		info_set_nodes_.insert(info_set_nodes_.end(), info_set_nodes.begin(), info_set_nodes.end());
+		info_set_node_starts_.push_back(static_cast<long long>(info_set_nodes_.size()));
+	}
+}
+
+NodePools::NodePools(Byte* root)
+{
+	//Nodes of each type are expanded in the order they were added, so child ranges
+	//are appended in index order.
+	std::vector<Byte*> queue;
+	queue.push_back(root);
+	root_ = AddNode(SearchTreeNode{ root });
+	for (std::size_t i_queue = 0; i_queue < queue.size(); i_queue++) {
+		SearchTreeNode node{ queue[i_queue] };
+		if (node.IsTerminalNode()) {
+			continue;
+		}
+		if (node.IsPlayerNode()) {
+			player_child_starts_.push_back(CheckedChildStart(player_children_.size()));
+		}
+		else {
+			chance_child_starts_.push_back(CheckedChildStart(chance_children_.size()));
+		}
+		Byte* child_pos = node.ChildrenStartOffset();
+		for (int i_child = 0; i_child < node.NumChildren(); i_child++) {
+			const NodeRef child_ref = AddNode(SearchTreeNode{ child_pos });
+			if (node.IsPlayerNode()) {
+				player_children_.push_back(child_ref);
+			}
+			else {
+				chance_children_.push_back(child_ref);
+				chance_probs_.push_back(node.ChildProbability(i_child));
+			}
+			queue.push_back(child_pos);
+			child_pos += TreeUtils::NodeSizeAt(child_pos);
+		}
+	}
+	player_child_starts_.push_back(CheckedChildStart(player_children_.size()));
+	chance_child_starts_.push_back(CheckedChildStart(chance_children_.size()));
+}
+
+NodePools::NodeRef NodePools::CheckedNodeRef(NodeType type, long long index)
+{
+	if (index < 0 || index > static_cast<long long>(kIndexMask)) {
+		throw std::length_error("Node pool index " + std::to_string(index) + " does not fit in "
+			+ std::to_string(kIndexBits) + " bits");
+	}
+	return ( NodeRef{ type } << kIndexBits ) | static_cast<NodeRef>(index);
+}
+
+std::uint32_t NodePools::CheckedChildStart(std::size_t child_start)
+{
+	if (child_start > std::numeric_limits<std::uint32_t>::max()) {
+		throw std::length_error("Node pool child start " + std::to_string(child_start)
+			+ " does not fit in 32 bits");
+	}
+	return static_cast<std::uint32_t>(child_start);
+}
+
+NodePools::NodeRef NodePools::AddNode(const SearchTreeNode& node)
+{
+	if (node.IsPlayerNode()) {
+		const NodeRef ref = CheckedNodeRef(kPlayer, static_cast<long long>(player_info_sets_.size()));
+		player_info_sets_.push_back(node.InfoSetPosition());
+		player_is_player_one_.push_back(node.IsPlayerOne());
+		return ref;
+	}
+	if (node.IsChanceNode()) {
+		//Chance nodes only hold child ranges, so count them by their expansion order.
+		return CheckedNodeRef(kChance, num_chance_nodes_++);
+	}
+	const NodeRef ref = CheckedNodeRef(kTerminal, static_cast<long long>(terminal_utilities_.size()));
+	terminal_utilities_.push_back(node.Utility());
+	return ref;
+}
+
+long long NodePools::NumNodes() const
+{
+	return static_cast<long long>(player_info_sets_.size()) + num_chance_nodes_
+		+ static_cast<long long>(terminal_utilities_.size());
+}
+
+long long NodePools::SizeInBytes() const
+{
+	return static_cast<long long>(
+		player_child_starts_.size() * sizeof(std::uint32_t) + player_info_sets_.size() * sizeof(Byte*)
+		+ player_is_player_one_.size() * sizeof(std::uint8_t) + player_children_.size() * sizeof(NodeRef)
+		+ chance_child_starts_.size() * sizeof(std::uint32_t) + chance_children_.size() * sizeof(NodeRef)
+		+ chance_probs_.size() * sizeof(float) + terminal_utilities_.size() * sizeof(float));
+}
+
+int NodePools::SampleChild(std::uint32_t index, float rand_float) const
+{
+	const int num_children = ChanceNumChildren(index);
+	const float* probs = chance_probs_.data() + chance_child_starts_[index];
+	float cumulative_prob = 0;
+	for (int i_child = 0; i_child < num_children - 1; i_child++) {
+		cumulative_prob += probs[i_child];
+		if (rand_float < cumulative_prob) {
+			return i_child;
+		}
+	}
+	return num_children - 1;
+}
+
+void SearchTreeLayout::CopyDepthFirst(
+	Byte* root, Byte* new_tree,
+	const std::unordered_map<Byte*, long long>* visit_counts
+) {
+	const int root_size = TreeUtils::NodeSizeAt(root);
+	std::memcpy(new_tree, root, root_size);
+	Byte* out = new_tree + root_size;
+	//Subtrees are copied in depth first pre-order, keeping the nodes left to copy on an
+	//explicit stack rather than recursing.
+	WalkStack<CopyFrame> stack;
+	stack.Push(CopyFrame{ root, new_tree });
+	while (!stack.Empty()) {
+		const CopyFrame frame = stack.Top();
+		stack.Pop();
+		CopyChildren(frame, out, visit_counts, stack);
+	}
+}
+
+void SearchTreeLayout::CopyChildren(
+	const CopyFrame& frame, Byte*& out, const std::unordered_map<Byte*, long long>* visit_counts,
+	WalkStack<CopyFrame>& stack
+) {
+	const SearchTreeNode old_node{ frame.old_node };
+	if (old_node.IsTerminalNode()) {
+		return;
+	}
+	//Siblings are copied as one block, so they can still be decoded in turn.
+	const int num_children = old_node.NumChildren();
+	std::vector<Byte*> old_children(num_children);
+	std::vector<Byte*> new_children(num_children);
+	TreeUtils::SetChildrenStart(frame.new_node, out);
+	Byte* old_child = old_node.ChildrenStartOffset();
+	for (int i_child = 0; i_child < num_children; i_child++) {
+		const int child_size = TreeUtils::NodeSizeAt(old_child);
+		std::memcpy(out, old_child, child_size);
+		old_children[i_child] = old_child;
+		new_children[i_child] = out;
+		old_child += child_size;
+		out += child_size;
+	}
+
+	std::vector<int> child_order(num_children);
+	for (int i_child = 0; i_child < num_children; i_child++) {
+		child_order[i_child] = i_child;
+	}
+	if (visit_counts != nullptr) {
+		auto visits = [&](int i_child) {
+			const auto it = visit_counts->find(old_children[i_child]);
+			return it == visit_counts->end() ? 0 : it->second;
+		};
+		std::stable_sort(child_order.begin(), child_order.end(),
+			[&](int lhs, int rhs) { return visits(lhs) > visits(rhs); });
+	}
+	//Pushed last to first, so the first child's subtree is copied next.
+	for (auto it = child_order.rbegin(); it != child_order.rend(); ++it) {
+		stack.Push(CopyFrame{ old_children[*it], new_children[*it] });
+	}
+}
+
+std::unordered_map<Byte*, long long> SearchTreeLayout::SampleVisitCounts(Byte* root, int num_samples, unsigned seed)
+{
+	std::unordered_map<Byte*, long long> visit_counts;
+	std::mt19937 rng{ seed };
+	std::uniform_real_distribution<float> uniform{ 0.0f, 1.0f };
+	for (int i_sample = 0; i_sample < num_samples; i_sample++) {
+		Byte* pos = root;
+		while (true) {
+			visit_counts[pos]++;
+			SearchTreeNode node{ pos };
+			if (node.IsTerminalNode()) {
+				break;
+			}
+			//Chance nodes are sampled by their probabilities, player nodes by their strategy.
+			ChildValues strategy_scratch(node.IsPlayerNode() ? node.NumChildren() : 0);
+			const float* strategy = node.IsPlayerNode()
+				? InfoSetData{ node.InfoSetPosition() }.CurrentStrategy(strategy_scratch.data()) : nullptr;
+			auto child_weight = [&](int i_child) {
+				return strategy != nullptr ? strategy[i_child] : node.ChildProbability(i_child);
+			};
+			const float rand_float = uniform(rng);
+			float cumulative_prob = 0;
+			pos = node.ChildrenStartOffset();
+			for (int i_child = 0; i_child < node.NumChildren() - 1; i_child++) {
+				cumulative_prob += child_weight(i_child);
+				if (rand_float < cumulative_prob) {
+					break;
+				}
+				pos += TreeUtils::NodeSizeAt(pos);
+			}
+		}
+	}
+	return visit_counts;
+}
+
+void SearchTreeLayout::CopyInfoSets(Byte* root, Byte* new_table, InfoSetOrder order)
+{
+	//Player nodes are found in the order CFR walks them: parents before children,
+	//children in order.
+	std::vector<Byte*> player_nodes;
+	std::vector<Byte*> stack;
+	stack.push_back(root);
+	while (!stack.empty()) {
+		Byte* pos = stack.back();
+		stack.pop_back();
+		SearchTreeNode node{ pos };
+		if (node.IsTerminalNode()) {
+			continue;
+		}
+		if (node.IsPlayerNode()) {
+			player_nodes.push_back(pos);
+		}
+		const std::size_t first_child = stack.size();
+		Byte* child_pos = node.ChildrenStartOffset();
+		for (int i_child = 0; i_child < node.NumChildren(); i_child++) {
+			stack.push_back(child_pos);
+			child_pos += TreeUtils::NodeSizeAt(child_pos);
+		}
+		std::reverse(stack.begin() + first_child, stack.end());
+	}
+
+	//Info sets are numbered by first touch, then placed one player after the other if grouped.
+	std::unordered_map<Byte*, Byte*> new_positions;
+	std::vector<Byte*> touch_order;
+	for (Byte* pos : player_nodes) {
+		Byte* info_set_pos = SearchTreeNode{ pos }.InfoSetPosition();
+		if (new_positions.insert({ info_set_pos, nullptr }).second) {
+			touch_order.push_back(info_set_pos);
+		}
+	}
+	if (order == InfoSetOrder::kTraversalByPlayer) {
+		std::unordered_map<Byte*, bool> is_player_one;
+		for (Byte* pos : player_nodes) {
+			SearchTreeNode node{ pos };
+			is_player_one.insert({ node.InfoSetPosition(), node.IsPlayerOne() });
+		}
+		std::stable_partition(touch_order.begin(), touch_order.end(),
+			[&](Byte* info_set_pos) { return is_player_one[info_set_pos]; });
+	}
+	Byte* out = new_table;
+	for (Byte* info_set_pos : touch_order) {
+		const int info_set_size = InfoSetData{ info_set_pos }.size();
+		std::memcpy(out, info_set_pos, info_set_size);
+		new_positions[info_set_pos] = out;
+		out += info_set_size;
+	}
+	for (Byte* pos : player_nodes) {
+		TreeUtils::SetInfoSetPosition(pos, new_positions[SearchTreeNode{ pos }.InfoSetPosition()]);
+	}
+}
+
 std::ostream& operator<<(std::ostream& os, const SearchTreeNode& search_node) {
 	if (search_node.IsPlayerNode()) {
 		os << "Tree Player node:\n";
@@ -186,8 +596,7 @@ std::ostream& operator<<(std::ostream& os, const SearchTreeNode& search_node) {
 		os << "Tree Chance node:\n";
 		os << "Num Children: " << static_cast<int>(search_node.NumChildren()) << "\n";
 		os << "Child Probabilities: [";
-		std::vector<float> probabilities = search_node.ChildProbabilities();
-		for (float prob : probabilities) {
+		for (float prob : search_node.ChildProbabilitySpan()) {
 			os << " " << prob << ",";
 		}
 		os << "]\n\n";
@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "framework.h"
+#include "cfr_thread_pool.h"
+
+
+//Index of the task deque owned by the current thread. The caller of a pool uses 0.
+static thread_local int tls_queue_index = 0;
+
+CfrThreadPool::CfrThreadPool(int num_threads)
+{
+	if (num_threads < 1) {
+		num_threads = static_cast<int>(std::thread::hardware_concurrency());
+	}
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
+	task_queues_ = std::make_unique<TaskQueue[]>(num_threads);
+	for (int i_worker = 1; i_worker < num_threads; i_worker++) {
+		workers_.emplace_back(&CfrThreadPool::WorkerLoop, this, i_worker);
+	}
+}
+
+CfrThreadPool::~CfrThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	work_ready_.notify_all();
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+}
+
+void CfrThreadPool::ParallelFor(
+	long long begin, long long end, long long grain_size, const RangeFunc& range_func
+) {
+	if (grain_size < 1) {
+		grain_size = 1;
+	}
+	//Small ranges are not worth waking the workers for.
+	if (workers_.empty() || end - begin <= grain_size) {
+		if (begin < end) {
+			range_func(begin, end);
+		}
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		range_func_ = &range_func;
+		range_end_ = end;
+		grain_size_ = grain_size;
+		next_chunk_.store(begin);
+		running_tasks_ = false;
+		pending_workers_ = static_cast<int>(workers_.size());
+		generation_++;
+	}
+	work_ready_.notify_all();
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	work_done_.wait(lock, [this] { return pending_workers_ == 0; });
+	range_func_ = nullptr;
+}
+
+void CfrThreadPool::RunTasks(const std::function<void()>& root_task)
+{
+	const int caller_queue_index = tls_queue_index;
+	tls_queue_index = 0;
+	if (workers_.empty()) {
+		root_task();
+		tls_queue_index = caller_queue_index;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_tasks_ = true;
+		tasks_finished_.store(false);
+		pending_workers_ = static_cast<int>(workers_.size());
+		generation_++;
+	}
+	work_ready_.notify_all();
+	root_task();
+	tasks_finished_.store(true, std::memory_order_release);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	work_done_.wait(lock, [this] { return pending_workers_ == 0; });
+	tls_queue_index = caller_queue_index;
+}
+
+void CfrThreadPool::Fork(CfrTask& task)
+{
+	TaskQueue& queue = task_queues_[tls_queue_index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	queue.tasks.push_back(&task);
+}
+
+void CfrThreadPool::Join(CfrTask& task)
+{
+	while (!task.done.load(std::memory_order_acquire)) {
+		CfrTask* next_task = NextTask();
+		if (next_task != nullptr) {
+			RunTask(next_task);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void CfrThreadPool::WorkerLoop(int worker_index)
+{
+	tls_queue_index = worker_index;
+	long long seen_generation = 0;
+	while (true) {
+		bool running_tasks;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			work_ready_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+			if (stopping_) {
+				return;
+			}
+			seen_generation = generation_;
+			running_tasks = running_tasks_;
+		}
+		if (running_tasks) {
+			while (!tasks_finished_.load(std::memory_order_acquire)) {
+				CfrTask* next_task = NextTask();
+				if (next_task != nullptr) {
+					RunTask(next_task);
+				}
+				else {
+					std::this_thread::yield();
+				}
+			}
+		}
+		else {
+			RunChunks();
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			pending_workers_--;
+			if (pending_workers_ == 0) {
+				work_done_.notify_one();
+			}
+		}
+	}
+}
+
+void CfrThreadPool::RunChunks()
+{
+	while (true) {
+		const long long chunk_begin = next_chunk_.fetch_add(grain_size_);
+		if (chunk_begin >= range_end_) {
+			return;
+		}
+		const long long chunk_end = std::min(chunk_begin + grain_size_, range_end_);
+		( *range_func_ )(chunk_begin, chunk_end);
+	}
+}
+
+CfrTask* CfrThreadPool::NextTask()
+{
+	//Newest task of our own first, as it is the one most likely still in cache.
+	{
+		TaskQueue& own_queue = task_queues_[tls_queue_index];
+		std::lock_guard<std::mutex> lock(own_queue.mutex);
+		if (!own_queue.tasks.empty()) {
+			CfrTask* task = own_queue.tasks.back();
+			own_queue.tasks.pop_back();
+			return task;
+		}
+	}
+	//Otherwise steal the oldest, and usually largest, task of another thread.
+	for (int i_offset = 1; i_offset < NumThreads(); i_offset++) {
+		TaskQueue& victim = task_queues_[( tls_queue_index + i_offset ) % NumThreads()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			CfrTask* task = victim.tasks.front();
+			victim.tasks.pop_front();
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+void CfrThreadPool::RunTask(CfrTask* task)
+{
+	task->func();
+	task->done.store(true, std::memory_order_release);
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include "pch.h"
+#include "framework.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief Unit of work forked onto a CfrThreadPool. The task object must outlive
+ *		  the Join() call that waits for it.
+ */
+struct CfrTask {
+	std::function<void()> func;
+	std::atomic<bool> done{ false };
+};
+
+
+/**
+ * @brief Persistent pool of worker threads used by the parallel CFR solvers.
+ *		  The calling thread always takes part in the work, so a pool of N threads
+ *		  starts N - 1 workers.
+ *		  Work is given either as an index range (ParallelFor) or as a tree of
+ *		  fork / join tasks (RunTasks). Each thread keeps a deque of the tasks it forked;
+ *		  it pops its own newest task first, while idle threads steal the oldest
+ *		  task from another thread's deque.
+ */
+class CfrThreadPool {
+
+	using RangeFunc = std::function<void(long long, long long)>;
+
+	/**
+	 * @brief Tasks forked by a single thread, guarded by their own mutex.
+	 */
+	struct TaskQueue {
+		std::mutex mutex;
+		std::deque<CfrTask*> tasks;
+	};
+
+	std::vector<std::thread> workers_;
+	std::unique_ptr<TaskQueue[]> task_queues_;
+
+	std::mutex mutex_;
+	std::condition_variable work_ready_;
+	std::condition_variable work_done_;
+
+	//Range currently being processed by ParallelFor.
+	const RangeFunc* range_func_ = nullptr;
+	long long range_end_ = 0;
+	long long grain_size_ = 1;
+	std::atomic<long long> next_chunk_{ 0 };
+
+	//Set while RunTasks is running, workers steal tasks until it finishes.
+	bool running_tasks_ = false;
+	std::atomic<bool> tasks_finished_{ false };
+
+	long long generation_ = 0;
+	int pending_workers_ = 0;
+	bool stopping_ = false;
+
+public:
+
+	/**
+	 * @param num_threads Total number of threads to use, including the caller.
+	 *		  A value below one uses every hardware thread.
+	 */
+	explicit CfrThreadPool(int num_threads);
+
+	~CfrThreadPool();
+
+	CfrThreadPool(const CfrThreadPool&) = delete;
+	CfrThreadPool& operator=(const CfrThreadPool&) = delete;
+
+	/**
+	 * @return Number of threads taking part in parallel work, including the caller.
+	 */
+	int NumThreads() const { return static_cast<int>(workers_.size()) + 1; }
+
+	/**
+	 * @brief Splits [begin, end) into chunks of grain_size indices and runs
+	 *		  range_func(chunk_begin, chunk_end) for each chunk across the pool.
+	 *		  Returns once every chunk has finished.
+	 */
+	void ParallelFor(long long begin, long long end, long long grain_size, const RangeFunc& range_func);
+
+	/**
+	 * @brief Runs root_task on the calling thread while the workers steal any tasks
+	 *		  it forks. Returns once root_task has finished.
+	 */
+	void RunTasks(const std::function<void()>& root_task);
+
+	/**
+	 * @brief Makes a task available to other threads. Only valid inside RunTasks.
+	 */
+	void Fork(CfrTask& task);
+
+	/**
+	 * @brief Waits for a forked task, running it or other pending tasks meanwhile.
+	 */
+	void Join(CfrTask& task);
+
+private:
+
+	void WorkerLoop(int worker_index);
+
+	void RunChunks();
+
+	/**
+	 * @return A task from the current thread's deque, or one stolen from another
+	 *		   thread, or nullptr if there is none.
+	 */
+	CfrTask* NextTask();
+
+	static void RunTask(CfrTask* task);
+};
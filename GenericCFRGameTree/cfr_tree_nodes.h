@@ -1,8 +1,17 @@
 #pragma once
 #include "pch.h"
 #include "framework.h"
+#include <cassert>
 #include <string>
 #include <cstdint>
+#include <cstring>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "cfr_walk_stack.h"
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+#include <xmmintrin.h>
+#endif
 
 
 /*
@@ -11,15 +20,100 @@
 ###########################################
 */
 
+/**
+ * @brief Layouts an info set can be stored in the regret table with.
+ *		  kPacked stores the current strategy, cumulative strategy and cumulative
+ *		  regret arrays back to back after a single word header.
+ *		  kCacheAligned starts each array on a 16 byte boundary, padding it to a whole
+ *		  number of 4 float lanes, and pads the info set to whole cache lines, so it
+ *		  never shares a line with another info set. The regret table starts on a
+ *		  cache line, so every array is aligned for vector loads.
+ *		  kDerivedStrategy is kPacked without the current strategy array, a third
+ *		  smaller. The current strategy is recomputed from the cumulative regrets by
+ *		  regret matching whenever a walk needs it. After a solve, it is read as the
+ *		  normalized cumulative strategy instead, until the next regret update.
+ */
+enum class InfoSetLayout {
+	kPacked,
+	kCacheAligned,
+	kDerivedStrategy
+};
+
+/**
+ * @brief Number formats the cumulative strategy and cumulative regret of an info set
+ *		  can be stored in. The current strategy is always stored as float.
+ *		  kFloat32 stores plain floats.
+ *		  kBFloat16 halves both arrays. Regrets keep the top half of each float, rounded
+ *		  stochastically, so updates far smaller than the 8 bit mantissa still add up on
+ *		  average instead of being rounded away. The cumulative strategy, which only grows,
+ *		  is stored as 16 bit integers sharing a power of two scale per info set, raised
+ *		  as the largest sum outgrows them. Its updates shrink relative to its sums as
+ *		  iterations go on, and the rounding noise of an 8 bit mantissa would keep the
+ *		  average strategy a few percent away from where its sums converge.
+ *		  kFixed32 stores 32 bit integers scaled by TreeUtils::kFixedPointScale, with a
+ *		  constant absolute resolution, saturating instead of overflowing. Updates are
+ *		  rounded stochastically, so those below the resolution are not lost either.
+ */
+enum class InfoSetPrecision {
+	kFloat32,
+	kBFloat16,
+	kFixed32
+};
+
 /**
  * @brief Util constants and functions to assist in tree preprocessing and construction.
  */
 class TreeUtils {
 public:
 	typedef unsigned char Byte;
-	static const int kNonTerminalBaseSize = sizeof(char) + sizeof(uint8_t) + sizeof(Byte*);
-	static const int kTerminalSize = sizeof(char) + sizeof(float);
-	static const int kPlayerNodeSize = kNonTerminalBaseSize + sizeof(Byte*) + sizeof(char);
+
+	//Nodes start on float aligned boundaries with a header holding the node type, the
+	//player and a variable width child count, padded to a float. Player and chance nodes
+	//follow it with the 32 bit offset of their children from the node, then either the
+	//info set pointer or the child probabilities. Nodes with fewer than 16384 children
+	//have a single word header. Terminals take 8 bytes, the header word and the utility,
+	//3 more than a tag byte and an unaligned float would. On a tree of mostly terminals,
+	//such as 300 actions per player node, that is 8.0 rather than 5.1 bytes per node,
+	//the price of keeping every record, and so every child probability, float aligned.
+	static const int kRecordAlignment = alignof(float);
+	static const int kPlayerOneOffset = sizeof(char);
+	static const int kChildCountOffset = kPlayerOneOffset + sizeof(bool);
+	static const int kChildrenOffsetSize = sizeof(std::uint32_t);
+	static const int kUtilityOffset = sizeof(float);
+	static const int kTerminalSize = kUtilityOffset + sizeof(float);
+
+	//Cache line size assumed when prefetching, and the most lines of a block prefetched at once.
+	static const int kCacheLineSize = 64;
+	static const int kMaxPrefetchLines = 8;
+
+	//Info set header holds the 32 bit action count, so strategy and regret arrays are float aligned.
+	//Its top bit marks an info set stored with InfoSetLayout::kCacheAligned, the next
+	//one an info set stored with InfoSetLayout::kDerivedStrategy, the two below hold
+	//its InfoSetPrecision, and the one below them marks a derived info set whose
+	//current strategy is its average strategy, until its regrets are next matched.
+	static const int kInfoSetHeaderSize = sizeof(std::uint32_t);
+	static const std::uint32_t kInfoSetAlignedFlag = std::uint32_t{ 1 } << 31;
+	static const std::uint32_t kInfoSetDerivedFlag = std::uint32_t{ 1 } << 30;
+	static const int kInfoSetPrecisionShift = 28;
+	static const std::uint32_t kInfoSetPrecisionMask = std::uint32_t{ 3 } << kInfoSetPrecisionShift;
+	static const std::uint32_t kInfoSetAveragedFlag = std::uint32_t{ 1 } << 27;
+	static const std::uint32_t kInfoSetCountMask = kInfoSetAveragedFlag - 1;
+
+	//Value of one unit of a kFixed32 info set: a resolution of about 0.001 and a range
+	//of about two million.
+	static constexpr float kFixedPointScale = 1.0f / 1024.0f;
+
+	//kBFloat16 info sets hold the float scale of their cumulative strategy after the header.
+	//It starts small enough that the first update raises it to fit, and so sums always use
+	//the top of the 16 bit range.
+	static const int kInfoSetScaleSize = sizeof(float);
+	static constexpr float kInitialStrategyScale = 1.0f / 1099511627776.0f;
+	static const int kMaxScaledStrategy = 65535;
+
+	//Array alignment of cache aligned info sets, and the alignment of the regret table.
+	static const int kInfoSetArrayAlignment = 16;
+	static_assert(kInfoSetHeaderSize + kInfoSetScaleSize <= kInfoSetArrayAlignment,
+		"the strategy scale fits before the first array of a cache aligned info set");
 	
 	/**
 	 * @brief General setters and getters for float and byte* types.
@@ -34,54 +128,166 @@ public:
 		return *( p_float );
 	}
 
+	//Pointers are only float aligned in the tree, so they are copied rather than cast.
 	static void SetBytePtrAtBytePtr(unsigned char* p_byte, unsigned char* ptr) {
-		Byte** p_byte_ptr = reinterpret_cast<Byte**>( p_byte );
-		*( p_byte_ptr ) = ptr;
+		std::memcpy(p_byte, &ptr, sizeof(Byte*));
+	}
+
+	static Byte* GetBytePtrAtBytePtr(const unsigned char* p_byte) {
+		Byte* ptr;
+		std::memcpy(&ptr, p_byte, sizeof(Byte*));
+		return ptr;
 	}
 
-	static Byte* GetBytePtrAtBytePtr(unsigned char* p_byte) {
-		Byte** p_byte_ptr = reinterpret_cast<Byte**>( p_byte );
-		return *( p_byte_ptr );
+	/**
+	 * @brief Hints the processor to start loading the cache lines holding
+	 *		  [address, address + num_bytes), up to kMaxPrefetchLines of them.
+	 */
+	static void Prefetch(const void* address, int num_bytes = 1) {
+		const char* line = static_cast<const char*>(address);
+		int num_lines = ( num_bytes + kCacheLineSize - 1 ) / kCacheLineSize;
+		num_lines = num_lines < kMaxPrefetchLines ? num_lines : kMaxPrefetchLines;
+		for (int i_line = 0; i_line < num_lines; i_line++, line += kCacheLineSize) {
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+			_mm_prefetch(line, _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+			__builtin_prefetch(line);
+#endif
+		}
+	}
+
+	/**
+	 * @return Number of bytes a child count takes, at 7 bits per byte.
+	 */
+	static int VarintSize(std::uint32_t value) {
+		int size = 1;
+		while (value >= 0x80) {
+			value >>= 7;
+			size++;
+		}
+		return size;
+	}
+
+	/**
+	 * @return Number of bytes taken by the header of a node with N children,
+	 *		   which is also the offset of its children offset.
+	 */
+	static int HeaderSize(int num_children) {
+		return AlignRecordSize(kChildCountOffset + VarintSize(static_cast<std::uint32_t>(num_children)));
 	}
 
 	/**
 	 * @return Number of bytes required to store a search tree node.
 	 */
-	static int PlayerNodeSizeInTree() { 
-		return kNonTerminalBaseSize + sizeof(Byte*) + sizeof(bool);
+	static int PlayerNodeSizeInTree(int num_children) { 
+		return HeaderSize(num_children) + kChildrenOffsetSize + static_cast<int>(sizeof(Byte*));
 	}
 
 	static int ChanceNodeSizeInTree(int numChildren) {
-		return kNonTerminalBaseSize + ( numChildren * sizeof(float) );
+		return HeaderSize(numChildren) + kChildrenOffsetSize + static_cast<int>(numChildren * sizeof(float));
 	}
 
 	static int TerminalNodeSizeInTree() { return kTerminalSize; }
 
+	/**
+	 * @return Number of bytes taken by the node set at a position, read from its header.
+	 */
+	static int NodeSizeAt(const Byte* tree_pos);
+
+	/**
+	 * @return Number of children of the player or chance node set at a position.
+	 */
+	static int ChildCountAt(const Byte* tree_pos);
+
+	/**
+	 * @return Size rounded up so that the next node stays aligned.
+	 */
+	static constexpr int AlignRecordSize(int size) {
+		return ( size + kRecordAlignment - 1 ) / kRecordAlignment * kRecordAlignment;
+	}
+
 	
 	/**
 	 * @brief Sets each type of node in the search tree with relevant data required.
+	 * @param children_offset Offset of the first child from the node. Children always
+	 *		  follow their parent, less than 4 GiB away.
 	 * @return Address of the next node to be set.
 	 */
-	static Byte* SetPlayerNode(Byte* tree_pos, int num_children, Byte* children_start, bool is_player_one, Byte* info_set_pointer);
+	static Byte* SetPlayerNode(Byte* tree_pos, int num_children, std::uint32_t children_offset, bool is_player_one, Byte* info_set_pointer);
 
-	static Byte* SetChanceNode(Byte* tree_pos, Byte* children_start, const std::vector<float>& child_probs);
+	static Byte* SetChanceNode(Byte* tree_pos, std::uint32_t children_offset, const std::vector<float>& child_probs);
 
 	static Byte* SetTerminalNode(Byte* tree_pos, float utility);
 
+	/**
+	 * @return The children offset, narrowed to the 32 bits it is stored in.
+	 * @throws std::length_error if the offset does not fit, as in a search tree whose
+	 *		   nodes are 4 GiB or more away from their children.
+	 */
+	static std::uint32_t CheckedChildrenOffset(long long children_offset);
+
+	/**
+	 * @brief Overwrites the children offset of a player or chance node,
+	 *		  and the info set pointer of a player node, already set in the tree.
+	 * @throws std::length_error if the children are too far away for their offset.
+	 */
+	static void SetChildrenStart(Byte* tree_pos, Byte* children_start);
+
+	static void SetChildrenOffset(Byte* tree_pos, std::uint32_t children_offset);
+
+	static void SetInfoSetPosition(Byte* tree_pos, Byte* info_set_pointer);
+
+	/**
+	 * @return Children offset of the player or chance node set at a position, as stored.
+	 */
+	static std::uint32_t ChildrenOffsetAt(const Byte* tree_pos);
+
 	/**
 	 * @return Number of bytes required to store an info set with N actions.
 	 */
-	static int InfoSetSize(int num_actions);
+	static int InfoSetSize(
+		int num_actions, InfoSetLayout layout = InfoSetLayout::kPacked,
+		InfoSetPrecision precision = InfoSetPrecision::kFloat32
+	);
+
+	/**
+	 * @return Number of bytes between the start of an info set array of values of the
+	 *		   given size and the start of the next array.
+	 */
+	static int InfoSetArraySize(int num_actions, InfoSetLayout layout, int value_size);
+
+	/**
+	 * @return Number of bytes a cumulative strategy or regret takes with a precision.
+	 */
+	static int InfoSetValueSize(InfoSetPrecision precision);
+
+	/**
+	 * @return Number of bytes before the first array of an info set: its header, and the
+	 *		   strategy scale of kBFloat16 info sets.
+	 */
+	static int InfoSetPrefixSize(InfoSetLayout layout, InfoSetPrecision precision);
 
 	/**
 	 * @brief Sets an Information Set in the regret table.
 	 * @return Address of the next Information Set to be set.
 	 */
-	static Byte* SetInfoSetNode(Byte* pos, int num_actions);
+	static Byte* SetInfoSetNode(
+		Byte* pos, int num_actions, InfoSetLayout layout = InfoSetLayout::kPacked,
+		InfoSetPrecision precision = InfoSetPrecision::kFloat32
+	);
+
+	/**
+	 * @brief Allocates and frees a regret table starting on a cache line.
+	 */
+	static Byte* AllocateRegretTable(long long size);
+
+	static void FreeRegretTable(Byte* regret_table);
 
 };
 
 
+class ChildRange;
+
 /**
  * @brief Object used to cast bytes in the search tree array for use by CFR algorithm.
  */
@@ -93,7 +299,7 @@ protected:
 	using Byte = unsigned char;
 
 	//Used to traverse to children for player and chance nodes.
-	uint8_t num_children_ = 0;
+	int num_children_ = 0;
 	Byte* p_child_start_offset_ = nullptr;
 
 	//Used to access Information Set in Information Set table for player nodes.
@@ -132,12 +338,17 @@ public:
 	/**
 	 * @brief Functions used by both Player and Chance Search Tree Nodes. 
 	 */
-	uint8_t NumChildren() const;
+	int NumChildren() const;
 
 	Byte* ChildrenStartOffset() const;
 
 	std::vector<SearchTreeNode> AllChildren() const;
 
+	/**
+	 * @return Range decoding each child in turn, without allocating.
+	 */
+	ChildRange Children() const;
+
 
 	/**
 	 * @brief Functions used only by the Player Search Tree Node.
@@ -152,10 +363,22 @@ public:
 	 */
 	std::vector<float> ChildProbabilities() const;
 
+	/**
+	 * @return View of the child probabilities stored in the search tree.
+	 */
+	std::span<const float> ChildProbabilitySpan() const;
+
+	float ChildProbability(int index) const;
+
 	std::vector<float> CumulativeChildProbs() const;
 
 	SearchTreeNode SampleChild() const;
 
+	/**
+	 * @brief Samples a child using a caller provided uniform number in [0, 1).
+	 */
+	SearchTreeNode SampleChild(float rand_float) const;
+
 
 	/**
 	 * @brief Functions used only by the Terminal Search Tree Node.
@@ -174,19 +397,564 @@ public:
 };
 
 std::ostream& operator<<(std::ostream& os, const SearchTreeNode& search_node);
+
+
+/**
+ * @brief Children of a player or chance node, contiguous in the search tree.
+ *		  Each child is decoded when its iterator is dereferenced.
+ */
+class ChildRange {
+
+	using Byte = unsigned char;
+
+	Byte* first_child_;
+	int num_children_;
+
+public:
+
+	class Iterator {
+		Byte* pos_;
+		int index_;
+	public:
+		Iterator(Byte* pos, int index) : pos_{ pos }, index_{ index } {}
+
+		SearchTreeNode operator*() const { return SearchTreeNode{ pos_ }; }
+
+		Iterator& operator++() {
+			pos_ += TreeUtils::NodeSizeAt(pos_);
+			index_++;
+			return *this;
+		}
+
+		bool operator==(const Iterator& other) const { return index_ == other.index_; }
+		bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+	};
+
+	ChildRange(Byte* first_child, int num_children) :
+		first_child_{ first_child }, num_children_{ num_children } {}
+
+	Iterator begin() const { return Iterator(first_child_, 0); }
+	Iterator end() const { return Iterator(nullptr, num_children_); }
+	int size() const { return num_children_; }
+};
+
+
+/**
+ * @brief Scratch values for the children of a single node, kept on the stack for
+ *		  up to kInlineChildren children and allocated for larger fan-outs.
+ * @tparam Value Floating point type of the values.
+ */
+template<typename Value = float>
+class ChildValues {
+
+	static const int kInlineChildren = 64;
+
+	Value inline_values_[kInlineChildren];
+	std::vector<Value> heap_values_;
+	Value* values_;
+
+public:
+
+	explicit ChildValues(int num_children) : values_{ inline_values_ } {
+		if (num_children > kInlineChildren) {
+			heap_values_.resize(num_children);
+			values_ = heap_values_.data();
+		}
+	}
+
+	ChildValues(const ChildValues&) = delete;
+	ChildValues& operator=(const ChildValues&) = delete;
+
+	Value& operator[](int index) { return values_[index]; }
+
+	Value operator[](int index) const { return values_[index]; }
+
+	Value* data() { return values_; }
+};
+
+/**
+ * @brief Scratch values for the children of a single node of a game whose fan-out is
+ *		  bounded at compile time, kept on the stack only. Has the interface of ChildValues.
+ */
+template<int kMaxChildren, typename Value = float>
+class FixedChildValues {
+
+	Value values_[kMaxChildren];
+
+public:
+
+	explicit FixedChildValues([[maybe_unused]] int num_children) { assert(num_children <= kMaxChildren); }
+
+	FixedChildValues(const FixedChildValues&) = delete;
+	FixedChildValues& operator=(const FixedChildValues&) = delete;
+
+	Value& operator[](int index) { return values_[index]; }
+
+	Value operator[](int index) const { return values_[index]; }
+
+	Value* data() { return values_; }
+};
+
+
+/**
+ * @brief How far ahead a walk prefetches, and the layout and precision of the regret
+ *		  table's info sets, which set how many bytes of each info set to prefetch.
+ */
+struct PrefetchOptions {
+	int distance = 0;
+	InfoSetLayout info_set_layout = InfoSetLayout::kPacked;
+	InfoSetPrecision info_set_precision = InfoSetPrecision::kFloat32;
+
+	int InfoSetBytes(int num_actions) const {
+		return TreeUtils::InfoSetSize(num_actions, info_set_layout, info_set_precision);
+	}
+};
+
+
+/**
+ * @brief Prefetches ahead of a walk over the children of a node. The block of child
+ *		  records is prefetched up front, then each time a child is walked, the info
+ *		  set and children of the sibling distance places ahead are prefetched, so
+ *		  they load while the current child's subtree is walked.
+ *		  A distance of zero prefetches nothing.
+ */
+class ChildPrefetcher {
+
+	using Byte = unsigned char;
+
+	Byte* ahead_pos_ = nullptr;
+	int ahead_index_ = 0;
+	int num_children_ = 0;
+	InfoSetLayout info_set_layout_;
+	InfoSetPrecision info_set_precision_;
+
+public:
+
+	ChildPrefetcher(const SearchTreeNode& node, const PrefetchOptions& prefetch) :
+		info_set_layout_{ prefetch.info_set_layout }, info_set_precision_{ prefetch.info_set_precision } {
+		if (prefetch.distance <= 0 || node.IsTerminalNode()) {
+			return;
+		}
+		num_children_ = node.NumChildren();
+		ahead_pos_ = node.ChildrenStartOffset();
+		TreeUtils::Prefetch(ahead_pos_, num_children_ * TreeUtils::kTerminalSize);
+		for (int i_child = 0; i_child < prefetch.distance; i_child++) {
+			Advance();
+		}
+	}
+
+	/**
+	 * @brief Prefetches for the next sibling ahead, called once before walking each child.
+	 */
+	void Advance() {
+		if (ahead_index_ >= num_children_) {
+			return;
+		}
+		ahead_index_++;
+		//Terminal nodes have nothing further to load, so they are skipped without decoding.
+		if (ahead_pos_[0] == 't') {
+			ahead_pos_ += TreeUtils::kTerminalSize;
+			return;
+		}
+		const SearchTreeNode ahead{ ahead_pos_ };
+		if (ahead.IsPlayerNode()) {
+			TreeUtils::Prefetch(ahead.InfoSetPosition(),
+				TreeUtils::InfoSetSize(ahead.NumChildren(), info_set_layout_, info_set_precision_));
+		}
+		TreeUtils::Prefetch(ahead.ChildrenStartOffset());
+		ahead_pos_ = ahead.NextNodePos();
+	}
+};
+
+
+/**
+ * @brief Open addressing hash index from 64 bit info set hashes to info set slots.
+ *		  Keys and slots are stored inline with linear probing, so no allocation is
+ *		  made per info set. Hash 0 marks an empty bucket, so its slot is kept outside
+ *		  the table, and every key stays distinct from every other.
+ */
+class InfoSetHashIndex {
+
+	std::vector<std::uint64_t> keys_;
+	std::vector<std::uint32_t> slots_;
+	long long size_ = 0;
+	bool has_zero_key_ = false;
+	std::uint32_t zero_key_slot_ = 0;
+
+public:
+
+	InfoSetHashIndex() = default;
+
+	/**
+	 * @brief Adds a key with the given slot, unless the key is already present.
+	 * @return The slot of the key, and whether it was inserted.
+	 */
+	std::pair<long long, bool> Insert(std::uint64_t key, long long slot);
+
+	long long Size() const { return size_; }
+
+private:
+
+	void Grow();
+};
+
+
+/**
+ * @brief Flat index over the depth ordered search tree, used by level synchronous solvers.
+ *		  Nodes are numbered depth by depth, so the children of a node are a contiguous
+ *		  run of indices in the next depth. Player nodes are also grouped by info set.
+ */
+class TreeLevelIndex {
+
+	using Byte = unsigned char;
+
+	//Position of each node in the search tree, ordered by depth.
+	std::vector<Byte*> node_positions_;
+	std::vector<long long> first_child_;
+	std::vector<long long> level_starts_;
+	std::vector<long long> subtree_sizes_;
+
+	//Player node indices grouped by the info set they update.
+	std::vector<Byte*> info_sets_;
+	std::vector<long long> info_set_node_starts_;
+	std::vector<long long> info_set_nodes_;
+
+public:
+
+	TreeLevelIndex() = default;
+
+	explicit TreeLevelIndex(Byte* root);
+
+	long long NumNodes() const { return static_cast<long long>(node_positions_.size()); }
+
+	int NumLevels() const { return static_cast<int>(level_starts_.size()) - 1; }
+
+	long long LevelStart(int depth) const { return level_starts_[depth]; }
+
+	long long LevelEnd(int depth) const { return level_starts_[depth + 1]; }
+
+	Byte* NodePosition(long long index) const { return node_positions_[index]; }
+
+	long long FirstChild(long long index) const { return first_child_[index]; }
+
+	/**
+	 * @return Number of nodes in the subtree rooted at a node, including itself.
+	 */
+	long long SubtreeSize(long long index) const { return subtree_sizes_[index]; }
+
+	long long NumInfoSets() const { return static_cast<long long>(info_sets_.size()); }
+
+	Byte* InfoSetPosition(long long index) const { return info_sets_[index]; }
+
+	/**
+	 * @return Range in InfoSetNode() of the player nodes sharing an info set.
+	 */
+	long long InfoSetNodesStart(long long index) const { return info_set_node_starts_[index]; }
+
+	long long InfoSetNodesEnd(long long index) const { return info_set_node_starts_[index + 1]; }
+
+	long long InfoSetNode(long long i_node) const { return info_set_nodes_[i_node]; }
+};
+
+
+/**
+ * @brief Representations the search tree can be walked in.
+ *		  kByteRecords walks the tagged node records of the search tree directly.
+ *		  kNodePools also builds NodePools, an index over the records that CFR and
+ *		  MCCFR then walk instead, while every other walk keeps reading the records.
+ */
+enum class TreeFormat {
+	kByteRecords,
+	kNodePools
+};
+
+
+/**
+ * @brief Orders the nodes of the search tree can be laid out in. The children of a
+ *		  node are always contiguous.
+ *		  kDepthOrder places each depth after the previous one, as the tree is built.
+ *		  kDepthFirst places the children of a node, then the subtree of each child in
+ *		  turn, so every subtree is a contiguous region right after its parent.
+ *		  kVisitOrder is kDepthFirst with the subtrees of siblings placed by how often
+ *		  a sampled warm-up walk visited them, most visited first.
+ */
+enum class TreeLayout {
+	kDepthOrder,
+	kDepthFirst,
+	kVisitOrder
+};
+
+
+/**
+ * @brief Orders the info sets of the regret table can be placed in.
+ *		  kBuildOrder places them in the order tree construction found them.
+ *		  kTraversalOrder places them in the order a CFR walk of the search tree
+ *		  first touches them, so info sets updated one after another are adjacent.
+ *		  kTraversalByPlayer does the same for each player in turn, so each player's
+ *		  update pass stays within one region of the table.
+ */
+enum class InfoSetOrder {
+	kBuildOrder,
+	kTraversalOrder,
+	kTraversalByPlayer
+};
+
+
+/**
+ * @brief How ConstructTree builds the search tree and the regret table.
+ *		  Each option defaults to the plain representation, so callers name only
+ *		  the ones they change.
+ */
+struct TreeOptions {
+	//Representation CFR and MCCFR walk.
+	TreeFormat format = TreeFormat::kByteRecords;
+	//Order of the nodes in the search tree.
+	TreeLayout layout = TreeLayout::kDepthOrder;
+	//Order of the info sets in the regret table.
+	InfoSetOrder info_set_order = InfoSetOrder::kBuildOrder;
+	//Layout of each info set.
+	InfoSetLayout info_set_layout = InfoSetLayout::kPacked;
+	//Number format of the cumulative strategy and regret.
+	InfoSetPrecision info_set_precision = InfoSetPrecision::kFloat32;
+};
+
+
+/**
+ * @brief Copies a search tree into a new layout, rewriting child offsets.
+ *		  Info set pointers are kept, so the regret table is unaffected.
+ */
+class SearchTreeLayout {
+
+	using Byte = unsigned char;
+
+public:
+
+	/**
+	 * @brief Copies the search tree rooted at root into new_tree, which must hold as
+	 *		  many bytes, in depth first order.
+	 * @param visit_counts Visits of each node by position in the old tree. Subtrees of
+	 *		  siblings are placed most visited first when given, in child order otherwise.
+	 */
+	static void CopyDepthFirst(
+		Byte* root, Byte* new_tree,
+		const std::unordered_map<Byte*, long long>* visit_counts = nullptr
+	);
+
+	/**
+	 * @brief Walks num_samples paths from the root, sampling chance nodes by their
+	 *		  probabilities and player nodes by their current strategy.
+	 * @return Number of times each visited node was visited, by position.
+	 */
+	static std::unordered_map<Byte*, long long> SampleVisitCounts(Byte* root, int num_samples, unsigned seed);
+
+	/**
+	 * @brief Copies the info sets of the search tree rooted at root into new_table,
+	 *		  which must hold as many bytes as the regret table, in the given order,
+	 *		  then points player nodes to their new positions.
+	 */
+	static void CopyInfoSets(Byte* root, Byte* new_table, InfoSetOrder order);
+
+private:
+
+	/**
+	 * @brief A node whose children are still to be copied, at its old and new positions.
+	 */
+	struct CopyFrame {
+		Byte* old_node;
+		Byte* new_node;
+	};
+
+	/**
+	 * @brief Copies the children of a node as a block at out, then pushes them so that
+	 *		  the subtree of each is copied in turn, in the order they are to be placed.
+	 */
+	static void CopyChildren(
+		const CopyFrame& frame, Byte*& out, const std::unordered_map<Byte*, long long>* visit_counts,
+		WalkStack<CopyFrame>& stack
+	);
+};
+
+
+/**
+ * @brief Index over the search tree, as separate arrays for player, chance and terminal nodes.
+ *		  Nodes are referred to by 32 bit references holding their type and index in
+ *		  their type's arrays. The children of each player or chance node are a range
+ *		  of references, so the k-th child is found without decoding its siblings, and
+ *		  chance probabilities are stored alongside the references to their children.
+ */
+class NodePools {
+
+	using Byte = unsigned char;
+
+public:
+
+	typedef std::uint32_t NodeRef;
+
+	enum NodeType : std::uint32_t {
+		kPlayer = 0,
+		kChance = 1,
+		kTerminal = 2
+	};
+
+	static const int kIndexBits = 30;
+	static const NodeRef kIndexMask = ( NodeRef{ 1 } << kIndexBits ) - 1;
+
+	static NodeType Type(NodeRef ref) { return static_cast<NodeType>(ref >> kIndexBits); }
+
+	static std::uint32_t Index(NodeRef ref) { return ref & kIndexMask; }
+
+	/**
+	 * @return Reference to the node at index in the pool of its type.
+	 * @throws std::length_error if the index does not fit in kIndexBits.
+	 */
+	static NodeRef CheckedNodeRef(NodeType type, long long index);
+
+	/**
+	 * @return Start of a node's range of children in its type's child array,
+	 *		   narrowed to the 32 bits it is stored in.
+	 * @throws std::length_error if the start does not fit.
+	 */
+	static std::uint32_t CheckedChildStart(std::size_t child_start);
+
+private:
+
+	//Player nodes, with their children at player_children_[player_child_starts_[i], player_child_starts_[i + 1]).
+	std::vector<std::uint32_t> player_child_starts_;
+	std::vector<Byte*> player_info_sets_;
+	std::vector<std::uint8_t> player_is_player_one_;
+	std::vector<NodeRef> player_children_;
+
+	//Chance nodes, with the probability of each child stored at the same index as its reference.
+	std::vector<std::uint32_t> chance_child_starts_;
+	std::vector<NodeRef> chance_children_;
+	std::vector<float> chance_probs_;
+	long long num_chance_nodes_ = 0;
+
+	std::vector<float> terminal_utilities_;
+
+	NodeRef root_ = 0;
+
+public:
+
+	NodePools() = default;
+
+	/**
+	 * @brief Copies the search tree rooted at root, breadth first, into node pools.
+	 *		  Player nodes keep pointing to their info sets in the regret table.
+	 * @throws std::length_error if a pool holds more nodes than a reference can index,
+	 *		   or a child array more entries than its 32 bit starts can address.
+	 */
+	explicit NodePools(Byte* root);
+
+	bool Empty() const { return terminal_utilities_.empty(); }
+
+	NodeRef Root() const { return root_; }
+
+	long long NumNodes() const;
+
+	/**
+	 * @return Number of bytes used by the pools.
+	 */
+	long long SizeInBytes() const;
+
+	/**
+	 * @brief Accessors for player nodes, by index in the player pool.
+	 */
+	int PlayerNumChildren(std::uint32_t index) const {
+		return static_cast<int>(player_child_starts_[index + 1] - player_child_starts_[index]);
+	}
+
+	NodeRef PlayerChild(std::uint32_t index, int i_child) const {
+		return player_children_[player_child_starts_[index] + i_child];
+	}
+
+	bool IsPlayerOne(std::uint32_t index) const { return player_is_player_one_[index] != 0; }
+
+	Byte* InfoSetPosition(std::uint32_t index) const { return player_info_sets_[index]; }
+
+	/**
+	 * @brief Accessors for chance nodes, by index in the chance pool.
+	 */
+	int ChanceNumChildren(std::uint32_t index) const {
+		return static_cast<int>(chance_child_starts_[index + 1] - chance_child_starts_[index]);
+	}
+
+	NodeRef ChanceChild(std::uint32_t index, int i_child) const {
+		return chance_children_[chance_child_starts_[index] + i_child];
+	}
+
+	float ChildProbability(std::uint32_t index, int i_child) const {
+		return chance_probs_[chance_child_starts_[index] + i_child];
+	}
+
+	const float* ChildProbabilities(std::uint32_t index) const {
+		return chance_probs_.data() + chance_child_starts_[index];
+	}
+
+	/**
+	 * @brief Prefetches the info set and children of a node, ahead of walking it.
+	 */
+	void Prefetch(NodeRef ref, const PrefetchOptions& prefetch) const {
+		const std::uint32_t index = Index(ref);
+		if (Type(ref) == kPlayer) {
+			TreeUtils::Prefetch(player_info_sets_[index], prefetch.InfoSetBytes(PlayerNumChildren(index)));
+			TreeUtils::Prefetch(player_children_.data() + player_child_starts_[index]);
+		}
+		else if (Type(ref) == kChance) {
+			TreeUtils::Prefetch(chance_children_.data() + chance_child_starts_[index]);
+			TreeUtils::Prefetch(chance_probs_.data() + chance_child_starts_[index]);
+		}
+	}
+
+	/**
+	 * @return Index of the child of a chance node that a uniform number in [0, 1) selects.
+	 */
+	int SampleChild(std::uint32_t index, float rand_float) const;
+
+	/**
+	 * @brief Accessor for terminal nodes, by index in the terminal pool.
+	 */
+	float Utility(std::uint32_t index) const { return terminal_utilities_[index]; }
+
+private:
+
+	/**
+	 * @brief Adds a node to the pool of its type, without its children.
+	 * @return Reference to the node.
+	 */
+	NodeRef AddNode(const SearchTreeNode& node);
+};
 		
 
 /**
- * @brief Object used to cast bytes in Regret Table for use by CFR algorithm
+ * @brief Object used to cast bytes in Regret Table for use by CFR algorithm.
+ *		  Values are read and written with relaxed atomics, so several threads may
+ *		  update the same info set at once. Concurrent additions may overwrite
+ *		  each other, but never tear a value.
  */
 class InfoSetData {
 
 	using byte = unsigned char;
 
-	uint8_t num_actions_;
+	int num_actions_;
+	InfoSetLayout layout_;
+	InfoSetPrecision precision_;
+	byte* p_header_;
 	byte* p_curr_strategy_;
 	byte* p_cum_strategy_;
 	byte* p_cum_regret_;
+	//Scale of the cumulative strategy of kBFloat16 info sets, nullptr otherwise.
+	byte* p_strategy_scale_;
+	//Whether a derived current strategy is the average strategy, as set by UseAverageStrategy.
+	bool averaged_;
+	//Sums normalizing single action reads, computed by the first such read and
+	//negative until then or after the values they sum change through this object.
+	float positive_regret_sum_;
+	float cumulative_strategy_sum_;
+
+	float PositiveRegretSum();
+
+	float CumulativeStrategySum();
 
 public:
 	InfoSetData(TreeUtils::Byte* pos);
@@ -195,18 +963,82 @@ public:
 
 	int NumActions();
 
+	InfoSetPrecision Precision();
+
 	float GetCurrentStrategy(int index);
 
 	float GetCumulativeStrategy(int index);
 
 	float GetCumulativeRegret(int index);
 
+	/**
+	 * @brief Ignored by info sets that derive their current strategy.
+	 */
 	void SetCurrentStrategy(float prob, int index);
 
 	void AddToCumulativeStrategy(float prob, int index);
 
 	void AddToCumulativeRegret(float prob, int index);
 
+	/**
+	 * @brief Sets a negative cumulative regret to exactly zero, as regret matching plus
+	 *		  floors it. With shared_table, a compare and swap replaces the regret only
+	 *		  while it is still negative, so concurrent additions are not lost.
+	 */
+	void FloorCumulativeRegret(int index, bool shared_table);
+
+	/**
+	 * @return Average strategy of an action, its cumulative strategy normalized over
+	 *		   the info set, or the uniform strategy before any has accumulated.
+	 */
+	float GetAverageStrategy(int index);
+
+	/**
+	 * @return Whether the info set stores its current strategy, rather than deriving
+	 *		   it from the cumulative regrets.
+	 */
+	bool StoresCurrentStrategy();
+
+	/**
+	 * @brief Makes the average strategy the current strategy, as after a solve. Info
+	 *		  sets that store it have it written over their array; derived ones read
+	 *		  their cumulative strategy normalized until ResumeRegretMatching.
+	 */
+	void UseAverageStrategy();
+
+	/**
+	 * @brief Derives the current strategy from the cumulative regrets again, after
+	 *		  UseAverageStrategy. Does nothing for info sets that store it.
+	 */
+	void ResumeRegretMatching();
+
+	/**
+	 * @brief Current strategy of every action. Info sets that store it return their
+	 *		  array; otherwise it is computed into scratch, which must hold NumActions()
+	 *		  floats, by regret matching the cumulative regrets.
+	 */
+	const float* CurrentStrategy(float* scratch);
+
+	/**
+	 * @brief Copies the current strategy of every action into strategy, which must hold
+	 *		  NumActions() floats, with relaxed loads only. Info sets that derive it regret
+	 *		  match the cumulative regrets loaded likewise. For walks sharing the regret
+	 *		  table with other threads, which must not read the arrays directly.
+	 * @return strategy.
+	 */
+	const float* LoadCurrentStrategy(float* strategy);
+
+	/**
+	 * @brief Raw access to the action arrays, for the vector kernels of CfrKernels.
+	 *		  The current strategy array is null unless the info set stores it, and the
+	 *		  cumulative arrays are null unless they are stored as kFloat32.
+	 */
+	float* CurrentStrategyData();
+
+	float* CumulativeStrategyData();
+
+	float* CumulativeRegretData();
+
 };
 
 std::ostream& operator<<(std::ostream& os, InfoSetData& info_set);
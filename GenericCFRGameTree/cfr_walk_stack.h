@@ -0,0 +1,75 @@
+#pragma once
+#include "pch.h"
+#include "framework.h"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Explicit stack for walking a tree without recursion. Holds one frame per
+ *		  node on the path from the root to the node being walked, and a stack of
+ *		  floats from which frames reserve per node scratch, such as the values of
+ *		  their children.
+ *		  Memory is kept when frames and values are popped, so a stack reused across
+ *		  walks of the same tree allocates only while walking deeper than before.
+ *		  Pushing may move the frames and values, so references to them are only
+ *		  valid until the next push, and frames refer to their values by offset.
+ */
+template<typename Frame>
+class WalkStack {
+
+	static const int kReservedFrames = 64;
+	static const int kReservedValues = 1024;
+
+	std::vector<Frame> frames_;
+	std::vector<float> values_;
+	std::size_t num_values_ = 0;
+
+public:
+
+	WalkStack() {
+		frames_.reserve(kReservedFrames);
+		values_.resize(kReservedValues);
+	}
+
+	WalkStack(const WalkStack&) = delete;
+	WalkStack& operator=(const WalkStack&) = delete;
+
+	template<typename... Args>
+	Frame& Push(Args&&... args) { return frames_.emplace_back(std::forward<Args>(args)...); }
+
+	void Pop() { frames_.pop_back(); }
+
+	Frame& Top() { return frames_.back(); }
+
+	bool Empty() const { return frames_.empty(); }
+
+	/**
+	 * @brief Reserves num_values floats on top of the value stack.
+	 * @return Offset of the first reserved float.
+	 */
+	std::size_t PushValues(int num_values) {
+		const std::size_t offset = num_values_;
+		num_values_ += num_values;
+		if (num_values_ > values_.size()) {
+			values_.resize(2 * num_values_);
+		}
+		return offset;
+	}
+
+	/**
+	 * @brief Releases the num_values floats on top of the value stack.
+	 */
+	void PopValues(int num_values) { num_values_ -= num_values; }
+
+	float* Values(std::size_t offset) { return values_.data() + offset; }
+
+	/**
+	 * @brief Drops every frame and value, keeping their memory.
+	 */
+	void Clear() {
+		frames_.clear();
+		num_values_ = 0;
+	}
+};
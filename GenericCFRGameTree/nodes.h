@@ -5,6 +5,13 @@
 #include <concepts>
 #include <functional>
 #include <string>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <variant>
+#include <span>
+#include <vector>
+#include <type_traits>
 
 
 
@@ -38,6 +45,35 @@ namespace CfrConcepts {
 
 	};
 
+	/*
+	- Optional: Action and ChanceNode may have ToHashValue(), and PlayerNode
+	 ToInfoSetHashValue(), funcs that return 64 bit hashes of the same information
+	 as their string hashes. When all three are present, info sets are identified
+	 by combining these values down the tree instead of building string hashes.
+	 Two info sets whose combined 64 bit hashes collide are merged into one. The
+	 odds are small, around n^2 / 2^65 for n info sets, but a merge cannot be told
+	 apart from a real shared info set unless their action counts differ, in which
+	 case ConstructTree() throws std::runtime_error.
+	 */
+	template<typename Action, typename PlayerNode, typename ChanceNode>
+	concept IntegerHashable = requires( const Action a, const PlayerNode p, const ChanceNode c ) {
+		{ a.ToHashValue() } -> std::convertible_to<std::uint64_t>;
+		{ c.ToHashValue() } -> std::convertible_to<std::uint64_t>;
+
+		{ p.ToInfoSetHashValue() } -> std::convertible_to<std::uint64_t>;
+	};
+
+}
+
+
+/**
+ * @brief Index of each node type in the variant stored by client and tree nodes.
+ *		  Terminal nodes hold no client node.
+ */
+namespace NodeIndex {
+	static constexpr std::size_t kTerminal = 0;
+	static constexpr std::size_t kPlayer = 1;
+	static constexpr std::size_t kChance = 2;
 }
 
 
@@ -47,64 +83,75 @@ namespace CfrConcepts {
  *		  metadata describing the action taken to get to a node such as:
  *			float - probability to reach a node from a parent chance node.
  *			action - action taken to reach a node from a parent player node.
+ *		  Only the stored node is held, and it is moved rather than copied where possible.
  */
 template<typename Action, typename PlayerNode, typename ChanceNode>
 class ClientNode {
 public:
+	typedef std::variant<std::monostate, PlayerNode, ChanceNode> NodeVariant;
+
 	Action action_;
-	PlayerNode player_node_;
-	ChanceNode chance_node_;
+	NodeVariant node_;
 
 	float probability_;
 
-	bool is_player_node_;
-	bool is_chance_node_;
-	bool is_terminal_node_;
-
 	ClientNode(PlayerNode p) :
-		action_{}, player_node_{ p }, chance_node_{}, probability_{ 1.0 },
-		is_player_node_{ true }, is_chance_node_{ false },
-		is_terminal_node_{ false } {}
+		action_{}, node_{ std::in_place_index<NodeIndex::kPlayer>, std::move(p) },
+		probability_{ 1.0 } {}
 
 	ClientNode(ChanceNode c) :
-		action_{}, player_node_{}, chance_node_{ c }, probability_{ 1.0 },
-		is_player_node_{ false }, is_chance_node_{ true },
-		is_terminal_node_{ false } {}
+		action_{}, node_{ std::in_place_index<NodeIndex::kChance>, std::move(c) },
+		probability_{ 1.0 } {}
 
 	ClientNode() :
-		action_{}, player_node_{}, chance_node_{}, probability_{ 1.0 },
-		is_player_node_{ false }, is_chance_node_{ false },
-		is_terminal_node_{ true } {}
+		action_{}, node_{}, probability_{ 1.0 } {}
 
 
 	ClientNode(PlayerNode p, float prob) :
-		ClientNode{ p } { probability_ = prob; }
+		ClientNode{ std::move(p) } { probability_ = prob; }
 
 	ClientNode(ChanceNode c, float prob) :
-		ClientNode{ c } { probability_ = prob; }
+		ClientNode{ std::move(c) } { probability_ = prob; }
 
 	ClientNode(float prob) :
 		ClientNode{} { probability_ = prob; }
 
 	ClientNode(PlayerNode p, Action a) :
-		ClientNode{ p } { action_ = a; }
+		ClientNode{ std::move(p) } { action_ = std::move(a); }
 
 	ClientNode(ChanceNode c, Action a) :
-		ClientNode{ c } { action_ = a;}
+		ClientNode{ std::move(c) } { action_ = std::move(a); }
 
 	ClientNode(Action a) :
 		ClientNode{} {
-		action_ = a;
+		action_ = std::move(a);
 	}
 
-	bool IsPlayerNode() const { return is_player_node_; }
-	bool IsChanceNode() const { return is_chance_node_; }
-	bool IsTerminalNode() const { return is_terminal_node_; }
+	bool IsPlayerNode() const { return node_.index() == NodeIndex::kPlayer; }
+	bool IsChanceNode() const { return node_.index() == NodeIndex::kChance; }
+	bool IsTerminalNode() const { return node_.index() == NodeIndex::kTerminal; }
 
-	Action GetAction() { return action_; }
-	PlayerNode GetPlayerNode() { return player_node_; }
-	ChanceNode GetChanceNode() { return chance_node_; }
+	/**
+	 * @brief Gettors for elements stored in a client node. Getting a node type that
+	 *		  is not stored returns a default constructed node.
+	 */
+	const Action& GetAction() const { return action_; }
+	const PlayerNode& GetPlayerNode() const { return StoredNode<NodeIndex::kPlayer>(node_); }
+	const ChanceNode& GetChanceNode() const { return StoredNode<NodeIndex::kChance>(node_); }
 	float GetProbability() const { return probability_; }
+
+	/**
+	 * @return Node of the given index held by a node variant, or a default constructed
+	 *		   node when the variant holds another type.
+	 */
+	template<std::size_t kIndex>
+	static const std::variant_alternative_t<kIndex, NodeVariant>& StoredNode(const NodeVariant& node) {
+		if (const auto* stored = std::get_if<kIndex>(&node)) {
+			return *stored;
+		}
+		static const std::variant_alternative_t<kIndex, NodeVariant> kDefaultNode{};
+		return kDefaultNode;
+	}
 };
 
 
@@ -113,81 +160,43 @@ requires CfrConcepts::Hashable<Action, PlayerNode, ChanceNode>&&
 		 CfrConcepts::PlayerNodePlayerOneFunc<PlayerNode>
 class TreeNode {
 
-	using Byte = unsigned char;
 	using TreeNodeList = std::vector<TreeNode>;
+	using CfrClientNode = ClientNode<Action, PlayerNode, ChanceNode>;
+	using NodeVariant = typename CfrClientNode::NodeVariant;
 protected:
 	Action action_;
-	PlayerNode player_node_;
-	ChanceNode chance_node_;
+	NodeVariant node_;
 
 	float probability_;
 
-	bool is_player_node_;
-	bool is_chance_node_;
-	bool is_terminal_node_;
 	TreeNode* parent_;
-	Byte* child_start_pos_;
-	bool is_child_start_set_;
+
+	//Hash of the path from the root as seen by each player, for integer hashable nodes.
+	std::uint64_t player_one_hash_ = 0;
+	std::uint64_t player_two_hash_ = 0;
 
 public:
 
-	TreeNode(const TreeNode<Action, PlayerNode, ChanceNode>& other) {
-		action_ = other.action_;
-		player_node_ = other.player_node_;
-		chance_node_ = other.chance_node_;
-		probability_ = other.probability_;
-		is_player_node_ = other.is_player_node_;
-		is_chance_node_ = other.is_chance_node_;
-		is_terminal_node_ = other.is_terminal_node_;
-		parent_ = other.parent_;
-		child_start_pos_ = nullptr;
-		is_child_start_set_ = false;
-	}
+	TreeNode(const TreeNode& other) = default;
+	TreeNode(TreeNode&& other) = default;
+	TreeNode& operator=(const TreeNode& other) = default;
+	TreeNode& operator=(TreeNode&& other) = default;
 
-	TreeNode (
-		const TreeNode<Action, PlayerNode, ChanceNode>& other,
-		TreeNode<Action, PlayerNode, ChanceNode>* parent
-	) {
-		action_ = other.action_;
-		player_node_ = other.player_node_;
-		chance_node_ = other.chance_node_;
-		probability_ = other.probability_;
-		is_player_node_ = other.is_player_node_;
-		is_chance_node_ = other.is_chance_node_;
-		is_terminal_node_ = other.is_terminal_node_;
-		parent_ = parent;
-		child_start_pos_ = nullptr;
-		is_child_start_set_ = false;
-	}
+	/**
+		* @brief Constructors that take the contents of another node, moving them
+		*		  when given an rvalue, and give it a parent tree node.
+		* @param parent Pointer to parent Tree Node.
+		*/
+	TreeNode(TreeNode other, TreeNode* parent) :
+		action_{ std::move(other.action_) }, node_{ std::move(other.node_) },
+		probability_{ other.probability_ }, parent_{ parent } { UpdatePathHashes(); }
 
-	TreeNode(
-		const ClientNode<Action, PlayerNode, ChanceNode>& other
-	) {
-		action_ = other.action_;
-		player_node_ = other.player_node_;
-		chance_node_ = other.chance_node_;
-		probability_ = other.probability_;
-		is_player_node_ = other.is_player_node_;
-		is_chance_node_ = other.is_chance_node_;
-		is_terminal_node_ = other.is_terminal_node_;
-		parent_ = nullptr;
-		child_start_pos_ = nullptr;
-		is_child_start_set_ = false;
-	}
+	TreeNode(CfrClientNode other) :
+		action_{ std::move(other.action_) }, node_{ std::move(other.node_) },
+		probability_{ other.probability_ }, parent_{ nullptr } {}
 
-	TreeNode(
-		const ClientNode<Action, PlayerNode, ChanceNode>& other,
-		TreeNode<Action, PlayerNode, ChanceNode>* parent
-	) {
-		action_ = other.action_;
-		player_node_ = other.player_node_;
-		chance_node_ = other.chance_node_;
-		probability_ = other.probability_;
-		is_player_node_ = other.is_player_node_;
-		is_chance_node_ = other.is_chance_node_;
-		is_terminal_node_ = other.is_terminal_node_;
-		parent_ = parent;
-	}
+	TreeNode(CfrClientNode other, TreeNode* parent) :
+		TreeNode{ std::move(other) } { parent_ = parent; UpdatePathHashes(); }
 
 
 
@@ -195,51 +204,47 @@ public:
 		* @brief Base constructors for each node type. 
 		*/
 	TreeNode(PlayerNode p) :
-		action_{}, player_node_{ p }, chance_node_{}, probability_{ 1.0 },
-		is_player_node_{ true }, is_chance_node_{ false },
-		is_terminal_node_{ false }, parent_{ nullptr } {}
+		action_{}, node_{ std::in_place_index<NodeIndex::kPlayer>, std::move(p) },
+		probability_{ 1.0 }, parent_{ nullptr } {}
 
 	TreeNode(ChanceNode c) :
-		action_{}, player_node_{}, chance_node_{ c }, probability_{ 1.0 },
-		is_player_node_{ false }, is_chance_node_{ true },
-		is_terminal_node_{ false }, parent_{ nullptr } {}
+		action_{}, node_{ std::in_place_index<NodeIndex::kChance>, std::move(c) },
+		probability_{ 1.0 }, parent_{ nullptr } {}
 
 	TreeNode() :
-		action_{}, player_node_{}, chance_node_{}, probability_{ 1.0 },
-		is_player_node_{ false }, is_chance_node_{ false },
-		is_terminal_node_{ true }, parent_{ nullptr } {}
+		action_{}, node_{}, probability_{ 1.0 }, parent_{ nullptr } {}
 
 	/**
 		* @brief Constructors that give node a parent tree node.
 		* @param parent Pointer to parent Tree Node.
 		*/
 	TreeNode(PlayerNode p, TreeNode* parent) : 
-		TreeNode{ p } { parent_ = parent; }
+		TreeNode{ std::move(p) } { parent_ = parent; UpdatePathHashes(); }
 
 	TreeNode(ChanceNode c, TreeNode* parent) :
-		TreeNode{ c } { parent_ = parent; }
+		TreeNode{ std::move(c) } { parent_ = parent; UpdatePathHashes(); }
 
 	TreeNode(TreeNode* parent) :
-		TreeNode{} { parent_ = parent; }
+		TreeNode{} { parent_ = parent; UpdatePathHashes(); }
 
 
 	/**
 		* @brief Constructors that set action taken to get to the node.
 		* @param a Action taken by parent node.
 		*/
-	TreeNode(PlayerNode p, Action a) : TreeNode{ p } { action_ = a; }
+	TreeNode(PlayerNode p, Action a) : TreeNode{ std::move(p) } { action_ = std::move(a); }
 
-	TreeNode(ChanceNode c, Action a) : TreeNode{ c } { action_ = a; }
+	TreeNode(ChanceNode c, Action a) : TreeNode{ std::move(c) } { action_ = std::move(a); }
 
-	TreeNode(Action a) : TreeNode{} { action_ = a; }
+	TreeNode(Action a) : TreeNode{} { action_ = std::move(a); }
 
 	/**
 		* @brief Constructors that set probability to get to the node.
 		* @param prob Probability of reach node.
 		*/
-	TreeNode(PlayerNode p, float prob) : TreeNode{ p } {probability_ = prob; }
+	TreeNode(PlayerNode p, float prob) : TreeNode{ std::move(p) } {probability_ = prob; }
 
-	TreeNode(ChanceNode c, float prob) : TreeNode{ c } {probability_ = prob; }
+	TreeNode(ChanceNode c, float prob) : TreeNode{ std::move(c) } {probability_ = prob; }
 
 	TreeNode(float prob) : TreeNode{} {probability_ = prob; }
 
@@ -247,17 +252,18 @@ public:
 	/**
 	 * @brief Returns the type of node stored in the current tree node.
 	 */
-	bool IsPlayerNode() { return is_player_node_; }
-	bool IsChanceNode() { return is_chance_node_; }
-	bool IsTerminalNode() { return is_terminal_node_; }
+	bool IsPlayerNode() const { return node_.index() == NodeIndex::kPlayer; }
+	bool IsChanceNode() const { return node_.index() == NodeIndex::kChance; }
+	bool IsTerminalNode() const { return node_.index() == NodeIndex::kTerminal; }
 
 	/**
-	 * @brief Gettors for elements stored in a tree node.
+	 * @brief Gettors for elements stored in a tree node. Getting a node type that
+	 *		  is not stored returns a default constructed node.
 	 */
-	Action GetAction() { return action_; }
-	PlayerNode GetPlayerNode() { return player_node_; }
-	ChanceNode GetChanceNode() { return chance_node_; }
-	float GetProbability() { return probability_; }
+	const Action& GetAction() const { return action_; }
+	const PlayerNode& GetPlayerNode() const { return CfrClientNode::template StoredNode<NodeIndex::kPlayer>(node_); }
+	const ChanceNode& GetChanceNode() const { return CfrClientNode::template StoredNode<NodeIndex::kChance>(node_); }
+	float GetProbability() const { return probability_; }
 
 	/**
 	 * @return Gets string representation of the history for info set evaluation.
@@ -267,7 +273,17 @@ public:
 			return "";
 		}
 		bool isPlayerOne = this->GetPlayerNode().IsPlayerOne();
-		return HistoryHashRecursive(isPlayerOne);
+		return HistoryHashInView(isPlayerOne);
+	}
+
+	/**
+	 * @return Hash of the history in the acting player's view, combined from the
+	 *		   client's 64 bit hash values. Only valid for player nodes.
+	 */
+	std::uint64_t InfoSetHashValue() const
+		requires CfrConcepts::IntegerHashable<Action, PlayerNode, ChanceNode>
+	{
+		return GetPlayerNode().IsPlayerOne() ? player_one_hash_ : player_two_hash_;
 	}
 
 	/**
@@ -275,46 +291,177 @@ public:
 	 * @return List of TreeNodes.
 	 */
 	TreeNodeList HistoryList() {
+		std::vector<const TreeNode*> path;
+		HistoryPath(path);
 		TreeNodeList historyList;
-		HistoryListRecursive(historyList, nullptr);
+		historyList.reserve(path.size());
+		for (std::size_t i_node = 0; i_node < path.size(); i_node++) {
+			historyList.push_back(*path[i_node]);
+			//Each node but the root takes the action taken from it, and the last node none.
+			if (i_node > 0) {
+				historyList.back().action_ = i_node + 1 < path.size() ? path[i_node + 1]->GetAction() : Action();
+			}
+		}
 		return historyList;
 	}
 
+	/**
+	 * @brief Fills a list with pointers to the nodes from the root to the current node,
+	 *		  without copying them. The list's memory is kept between calls.
+	 */
+	void HistoryPath(std::vector<const TreeNode*>& path) const {
+		path.clear();
+		for (const TreeNode* node = this; node != nullptr; node = node->parent_) {
+			path.push_back(node);
+		}
+		std::reverse(path.begin(), path.end());
+	}
+
 private:
 
-	std::string HistoryHashRecursive(bool isPlayerOne) {
-		if (parent_ == nullptr) {
-			return "";
-		} else if (this->IsChanceNode()) {
-			return this->GetChanceNode().ToHash() + parent_->HistoryHash();
-		} else if (this->GetPlayerNode().IsPlayerOne() == isPlayerOne) {
-			std::string currentHash = this->GetPlayerNode().ToInfoSetHash();
-			currentHash += this->GetAction().ToHash();
-			return currentHash + parent_->HistoryHashRecursive(isPlayerOne);
-		} else {
-			return this->GetAction().ToHash() + parent_->HistoryHashRecursive(isPlayerOne);
-		}	
+	/**
+	 * @brief Mixes a value into a path hash so that order and position both matter.
+	 */
+	static std::uint64_t CombineHash(std::uint64_t hash, std::uint64_t value) {
+		hash += 0x9e3779b97f4a7c15ULL + value;
+		hash = ( hash ^ ( hash >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+		hash = ( hash ^ ( hash >> 27 ) ) * 0x94d049bb133111ebULL;
+		return hash ^ ( hash >> 31 );
 	}
 
-	void HistoryListRecursive(TreeNodeList& historyList, TreeNode* lastChild) {
-		if (this == nullptr) {
-			return;
-		}
-		else if (this->parent_ == nullptr) {
-			historyList.push_back(*this);
+	/**
+	 * @brief Extends the parent's path hashes with this node. Both players see the
+	 *		  action taken to reach a node and every chance node, while the private
+	 *		  information of a player node is only seen by the acting player.
+	 */
+	void UpdatePathHashes() {
+		if constexpr (CfrConcepts::IntegerHashable<Action, PlayerNode, ChanceNode>) {
+			if (parent_ == nullptr) {
+				return;
+			}
+			player_one_hash_ = parent_->player_one_hash_;
+			player_two_hash_ = parent_->player_two_hash_;
+			if (parent_->IsPlayerNode()) {
+				const std::uint64_t action_hash = CombineHash(1, action_.ToHashValue());
+				player_one_hash_ = CombineHash(player_one_hash_, action_hash);
+				player_two_hash_ = CombineHash(player_two_hash_, action_hash);
+			}
+			if (this->IsChanceNode()) {
+				const std::uint64_t chance_hash = CombineHash(2, GetChanceNode().ToHashValue());
+				player_one_hash_ = CombineHash(player_one_hash_, chance_hash);
+				player_two_hash_ = CombineHash(player_two_hash_, chance_hash);
+			}
+			else if (this->IsPlayerNode()) {
+				const PlayerNode& player_node = GetPlayerNode();
+				const std::uint64_t info_set_hash = CombineHash(3, player_node.ToInfoSetHashValue());
+				if (player_node.IsPlayerOne()) {
+					player_one_hash_ = CombineHash(player_one_hash_, info_set_hash);
+				}
+				else {
+					player_two_hash_ = CombineHash(player_two_hash_, info_set_hash);
+				}
+			}
 		}
-		else {
-			this->parent_->HistoryListRecursive(historyList, this);
-			TreeNode toAdd(*this);
-			if (lastChild != nullptr) {
-				toAdd.action_ = lastChild->GetAction();
+	}
+
+	/**
+	 * @return Hash of the history from this node up to the root in the view of the given
+	 *		   player, walking up the parents. Above a chance node the history is hashed
+	 *		   in the view of the player acting at its parent, or not at all when the
+	 *		   parent is not a player node.
+	 */
+	std::string HistoryHashInView(bool isPlayerOne) const {
+		std::string hash;
+		const TreeNode* node = this;
+		while (node->parent_ != nullptr) {
+			if (node->IsChanceNode()) {
+				hash += node->GetChanceNode().ToHash();
+				node = node->parent_;
+				if (!node->IsPlayerNode()) {
+					break;
+				}
+				isPlayerOne = node->GetPlayerNode().IsPlayerOne();
+				continue;
 			}
-			else {
-				toAdd.action_ = Action();
+			if (node->GetPlayerNode().IsPlayerOne() == isPlayerOne) {
+				hash += node->GetPlayerNode().ToInfoSetHash();
 			}
-			historyList.push_back(toAdd);
+			hash += node->GetAction().ToHash();
+			node = node->parent_;
+		}
+		return hash;
+	}
+};
+
+/**
+ * @brief Non-owning view of the history from the root to a terminal node, over the
+ *		  nodes alive while the tree is constructed. Gives the same information as
+ *		  TreeNode::HistoryList() without copying any node: each entry's action is
+ *		  the action taken from that node, and the terminal node's action is empty.
+ *		  Only valid during the UtilityFunc() call it is passed to.
+ */
+template<typename Action, typename PlayerNode, typename ChanceNode>
+class HistoryView {
+
+	using HistoryNode = TreeNode<Action, PlayerNode, ChanceNode>;
+
+	const HistoryNode* const* path_;
+	std::size_t size_;
+
+public:
+
+	/**
+	 * @brief Entry of a history view, a node and the action taken from it.
+	 */
+	class Entry {
+		const HistoryNode* node_;
+		const HistoryNode* next_;
+	public:
+		Entry(const HistoryNode* node, const HistoryNode* next) : node_{ node }, next_{ next } {}
+
+		bool IsPlayerNode() const { return node_->IsPlayerNode(); }
+		bool IsChanceNode() const { return node_->IsChanceNode(); }
+		bool IsTerminalNode() const { return node_->IsTerminalNode(); }
+
+		const PlayerNode& GetPlayerNode() const { return node_->GetPlayerNode(); }
+		const ChanceNode& GetChanceNode() const { return node_->GetChanceNode(); }
+		float GetProbability() const { return node_->GetProbability(); }
+		const Action& GetAction() const {
+			static const Action kNoAction{};
+			return next_ != nullptr ? next_->GetAction() : kNoAction;
 		}
+	};
+
+	class Iterator {
+		const HistoryView* view_;
+		std::size_t index_;
+	public:
+		Iterator(const HistoryView* view, std::size_t index) : view_{ view }, index_{ index } {}
+		Entry operator*() const { return ( *view_ )[index_]; }
+		Iterator& operator++() { index_++; return *this; }
+		bool operator==(const Iterator& other) const { return index_ == other.index_; }
+		bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+	};
+
+	HistoryView() : path_{ nullptr }, size_{ 0 } {}
+
+	explicit HistoryView(const std::vector<const HistoryNode*>& path) :
+		path_{ path.data() }, size_{ path.size() } {}
+
+	HistoryView(const HistoryNode* const* path, std::size_t size) :
+		path_{ path }, size_{ size } {}
+
+	std::size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
+	Entry operator[](std::size_t index) const {
+		return Entry(path_[index], index + 1 < size_ ? path_[index + 1] : nullptr);
 	}
+	Entry front() const { return ( *this )[0]; }
+	Entry back() const { return ( *this )[size_ - 1]; }
+
+	Iterator begin() const { return Iterator(this, 0); }
+	Iterator end() const { return Iterator(this, size_); }
 };
 
 /**
@@ -323,15 +470,32 @@ private:
 template<typename Action, typename PlayerNode, typename ChanceNode>
 static std::vector<float> ToFloatList
 (
-	std::vector<ClientNode<Action, PlayerNode, ChanceNode>>& nodeList
+	const std::vector<ClientNode<Action, PlayerNode, ChanceNode>>& nodeList
 ) {
 	std::vector<float> floatList;
-	for (ClientNode<Action, PlayerNode, ChanceNode> node : nodeList) {
+	floatList.reserve(nodeList.size());
+	for (const ClientNode<Action, PlayerNode, ChanceNode>& node : nodeList) {
 		floatList.push_back(node.GetProbability());
 	}
 	return floatList;
 }
 
+/**
+ * @brief Writes the probabilities of the children of a chance node into a list given
+ *		  by the caller, replacing its contents but keeping its memory.
+ */
+template<typename Action, typename PlayerNode, typename ChanceNode>
+static void ToFloatList
+(
+	const std::vector<ClientNode<Action, PlayerNode, ChanceNode>>& nodeList,
+	std::vector<float>& floatList
+) {
+	floatList.clear();
+	for (const ClientNode<Action, PlayerNode, ChanceNode>& node : nodeList) {
+		floatList.push_back(node.GetProbability());
+	}
+}
+
 /**
  * @brief Requirements for the client to be able to use the generic cfr class.
  */
@@ -350,6 +514,18 @@ namespace CfrConcepts {
 		{ p.ActionList(&g) } -> std::convertible_to<std::vector<Action>>;
 	};
 
+	/*Alternatively, Player node may write the actions it can take into a list given by the library.
+	 The list is empty when passed, and is reused between nodes so that its memory is kept.*/
+	template<typename Action, typename PlayerNode, typename GameState>
+	concept PlayerNodeActionListIntoFunc = requires ( const PlayerNode p, const GameState g, std::vector<Action>& actions ) {
+		p.ActionList(&g, actions);
+	};
+
+	template<typename Action, typename PlayerNode, typename GameState>
+	concept PlayerNodeActionsFunc =
+		PlayerNodeActionListFunc<Action, PlayerNode, GameState> ||
+		PlayerNodeActionListIntoFunc<Action, PlayerNode, GameState>;
+
 
 	/*Chance Node must have function that returns vector of child nodes*/
 	template<typename Action, typename PlayerNode, typename ChanceNode, typename GameState>
@@ -358,14 +534,74 @@ namespace CfrConcepts {
 
 	};
 
+	/*Alternatively, Chance Node may write its child nodes into a list given by the library.
+	 The list is empty when passed, and is reused between nodes so that its memory is kept.*/
+	template<typename Action, typename PlayerNode, typename ChanceNode, typename GameState>
+	concept ChanceNodeChildrenIntoFunc = requires( const ChanceNode c, const GameState g,
+		std::vector<ClientNode<Action, PlayerNode, ChanceNode>>& children ) {
+		c.Children(&g, children);
+	};
+
+	template<typename Action, typename PlayerNode, typename ChanceNode, typename GameState>
+	concept ChanceNodeChildListFunc =
+		ChanceNodeChildrenFunc<Action, PlayerNode, ChanceNode, GameState> ||
+		ChanceNodeChildrenIntoFunc<Action, PlayerNode, ChanceNode, GameState>;
+
 	/*Client Game class must have a function that evaluates the utility at a terminal node.*/
 	template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
-	concept NeedsUtilityFunc = requires( const Action a, const PlayerNode p, const ChanceNode c, const GameClass g ) {
+	concept UtilityListFunc = requires( const Action a, const PlayerNode p, const ChanceNode c, const GameClass g ) {
 
 		{ g.UtilityFunc(std::vector<TreeNode<Action, PlayerNode, ChanceNode>>()) } ->
 			std::convertible_to<float>;
 	};
 
+	/*Alternatively, the utility function may take a history view, which does not copy the history.*/
+	template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
+	concept UtilityViewFunc = requires( const GameClass g ) {
+
+		{ g.UtilityFunc(HistoryView<Action, PlayerNode, ChanceNode>()) } ->
+			std::convertible_to<float>;
+	};
+
+	/*Alternatively, or as well, the Game class may evaluate many terminal histories in one call,
+	 writing the utility of each history into the matching entry of utilities.*/
+	template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
+	concept UtilityBatchFunc = requires( const GameClass g,
+		std::span<const HistoryView<Action, PlayerNode, ChanceNode>> histories, std::span<float> utilities ) {
+
+		g.UtilityBatch(histories, utilities);
+	};
+
+	/*Optional: Game class may have a TerminalKey() func that returns a 64 bit key of the
+	 payoff relevant part of a terminal history. Terminals with equal keys must have equal
+	 utilities, and utilities are then evaluated once per key in each subtree build.*/
+	template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
+	concept TerminalKeyFunc = requires( const GameClass g, const HistoryView<Action, PlayerNode, ChanceNode> h ) {
+
+		{ g.TerminalKey(h) } -> std::convertible_to<std::uint64_t>;
+	};
+
+	/*Optional: Game class may declare static constexpr int kMaxActions, an upper bound on the
+	 number of actions of any player node, and kMaxChanceChildren, an upper bound on the number
+	 of children of any chance node. Walks then keep per node scratch in fixed size arrays and
+	 unroll loops over small fan-outs. ConstructTree() throws std::length_error for a node with
+	 more children than its bound, and a bound below one is treated as no bound.*/
+	template<typename GameClass>
+	concept StaticMaxActions = requires {
+		typename std::integral_constant<int, GameClass::kMaxActions>;
+	} && ( GameClass::kMaxActions > 0 );
+
+	template<typename GameClass>
+	concept StaticMaxChanceChildren = requires {
+		typename std::integral_constant<int, GameClass::kMaxChanceChildren>;
+	} && ( GameClass::kMaxChanceChildren > 0 );
+
+	template<typename Action, typename PlayerNode, typename ChanceNode, typename GameClass>
+	concept NeedsUtilityFunc =
+		UtilityListFunc<Action, PlayerNode, ChanceNode, GameClass> ||
+		UtilityViewFunc<Action, PlayerNode, ChanceNode, GameClass> ||
+		UtilityBatchFunc<Action, PlayerNode, ChanceNode, GameClass>;
+
 }
 
 
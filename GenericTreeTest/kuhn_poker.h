@@ -0,0 +1,108 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "cfr.h"
+#include "nodes.h"
+
+
+/**
+ * @brief Kuhn poker. Each player antes 1 and is dealt one of a jack, queen and king,
+ *		  then player one passes or bets 1. A bet is called or folded to, and a pass
+ *		  is passed back or bet after, in which case player one calls or folds.
+ *		  Its game value is -1/18 for player one.
+ */
+class KuhnPoker {
+public:
+
+	class Action;
+	class Player;
+	class ChanceNode;
+
+	using Node = ClientNode<Action, Player, ChanceNode>;
+
+	class Action {
+	public:
+		//'p' passes or folds, 'b' bets or calls.
+		char action_ = 'n';
+		Action() = default;
+		explicit Action(char in_action) : action_{ in_action } {}
+		std::string ToHash() const { return std::string(1, action_); }
+	};
+
+	class Player {
+	public:
+		int card_one_ = 0;
+		int card_two_ = 0;
+		std::string history_;
+		bool player_one_ = true;
+
+		Player() = default;
+		Player(int card_one, int card_two, std::string history, bool player_one)
+			: card_one_{ card_one }, card_two_{ card_two }, history_{ std::move(history) }, player_one_{ player_one } {}
+
+		bool IsPlayerOne() const { return player_one_; }
+		std::string ToHash() const { return history_; }
+		std::string ToInfoSetHash() const {
+			return std::to_string(player_one_ ? card_one_ : card_two_) + ( player_one_ ? "A" : "B" ) + history_;
+		}
+		Node Child(const Action a, const KuhnPoker*) const {
+			const std::string child_history = history_ + a.action_;
+			if (IsTerminalHistory(child_history)) {
+				return Node{ a };
+			}
+			return Node{ Player{ card_one_, card_two_, child_history, !player_one_ }, a };
+		}
+		std::vector<Action> ActionList(const KuhnPoker*) const {
+			return { Action{ 'p' }, Action{ 'b' } };
+		}
+	};
+
+	class ChanceNode {
+	public:
+		std::string ToHash() const { return "Deal"; }
+		std::vector<Node> Children(const KuhnPoker*) const {
+			std::vector<Node> deals;
+			for (int card_one = 0; card_one < 3; card_one++) {
+				for (int card_two = 0; card_two < 3; card_two++) {
+					if (card_one != card_two) {
+						deals.push_back(Node{ Player{ card_one, card_two, "", true }, 1.0f / 6.0f });
+					}
+				}
+			}
+			return deals;
+		}
+	};
+
+	using HistoryNode = TreeNode<Action, Player, ChanceNode>;
+
+	static bool IsTerminalHistory(const std::string& history) {
+		return history == "pp" || history == "bp" || history == "bb" || history == "pbp" || history == "pbb";
+	}
+
+	float UtilityFunc(std::vector<HistoryNode> history) const {
+		Player last_player;
+		char last_action = 'n';
+		for (const HistoryNode& history_node : history) {
+			//Each player node holds the action taken from it.
+			if (history_node.IsPlayerNode()) {
+				last_player = history_node.GetPlayerNode();
+				last_action = history_node.GetAction().action_;
+			}
+		}
+		const std::string betting = last_player.history_ + last_action;
+		const float showdown = last_player.card_one_ > last_player.card_two_ ? 1.0f : -1.0f;
+		if (betting == "bp") {
+			return 1.0f;
+		}
+		if (betting == "pbp") {
+			return -1.0f;
+		}
+		return betting == "pp" ? showdown : 2.0f * showdown;
+	}
+
+	ChanceNode chance_node_{};
+
+	//Players pass or bet, and the root chance node deals six pairs of cards.
+	static constexpr int kMaxActions = 2;
+	static constexpr int kMaxChanceChildren = 6;
+};
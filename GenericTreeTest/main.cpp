@@ -1,8 +1,24 @@
+#include <algorithm>
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include "rock_paper_scissors.h"
+#include "tree_tests.h"
 #include "cfr.h"
 
 
+/**
+ * @brief Rock paper scissors without its fan-out bounds, to compare walks of runtime
+ *		  sized scratch against the fixed size scratch and unrolled loops of the bounded game.
+ */
+class UnboundedRockPaperScissors : public RockPaperScissors {
+public:
+	static constexpr int kMaxActions = 0;
+	static constexpr int kMaxChanceChildren = 0;
+};
+
+
 int main(int argc, char* argv[]) {
 
 	using Player = RockPaperScissors::Player;
@@ -12,6 +28,8 @@ int main(int argc, char* argv[]) {
 
 	using CFRTree = CfrTree<Action, Player, ChanceNode, Game>;
 
+	const int test_failures = TreeTests::RunAll();
+
 	RockPaperScissors* game = new RockPaperScissors();
 	ChanceNode root = game->chance_node_;
 
@@ -25,6 +43,190 @@ int main(int argc, char* argv[]) {
 	tree->MCCFR_ToAccuracy(0.1);
 	std::cout << "After CFR: \n\n";
 	tree->PrintTree();
-	
+
+	//Report multithreaded MCCFR throughput at every thread count up to the hardware threads.
+	const int scaling_iterations = 200000;
+	const int max_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	std::cout << max_threads << " hardware threads\n";
+	CFRTree* scaling_tree = new CFRTree(game, root);
+	scaling_tree->ConstructTree();
+	for (int num_threads = 1; num_threads <= max_threads; num_threads++) {
+		auto start = std::chrono::steady_clock::now();
+		scaling_tree->MCCFR_Parallel(scaling_iterations, num_threads);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << num_threads << " threads: " << scaling_iterations / elapsed.count() << " iterations/sec\n";
+	}
+
+	//Compare CFR throughput walking the byte records and walking the node pools indexing them.
+	const int format_iterations = 20000;
+	for (const TreeFormat format : { TreeFormat::kByteRecords, TreeFormat::kNodePools }) {
+		CFRTree* format_tree = new CFRTree(game, root);
+		format_tree->ConstructTree(1, { .format = format });
+		const bool uses_pools = format == TreeFormat::kNodePools;
+		auto start = std::chrono::steady_clock::now();
+		format_tree->CFR(format_iterations);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		//Each iteration walks every node once per player.
+		const double nodes_walked = 2.0 * format_iterations * format_tree->NumNodes();
+		std::cout << ( uses_pools ? "Node pools: " : "Byte records: " ) << nodes_walked / elapsed.count() << " nodes/sec";
+		if (uses_pools) {
+			std::cout << ", indexed in " << format_tree->NodePoolsSize() << " bytes on top of the search tree";
+		}
+		std::cout << "\n";
+	}
+
+	//Compare CFR throughput of each search tree layout.
+	for (const TreeLayout layout : { TreeLayout::kDepthOrder, TreeLayout::kDepthFirst, TreeLayout::kVisitOrder }) {
+		CFRTree* layout_tree = new CFRTree(game, root);
+		layout_tree->ConstructTree(1, { .layout = layout });
+		auto start = std::chrono::steady_clock::now();
+		layout_tree->CFR(format_iterations);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		const char* layout_name = layout == TreeLayout::kDepthOrder ? "Depth order: "
+			: layout == TreeLayout::kDepthFirst ? "Depth first: " : "Visit order: ";
+		std::cout << layout_name << 2.0 * format_iterations * layout_tree->NumNodes() / elapsed.count() << " nodes/sec\n";
+	}
+
+	//Compare CFR throughput of each info set order in the regret table.
+	for (const InfoSetOrder info_set_order :
+		{ InfoSetOrder::kBuildOrder, InfoSetOrder::kTraversalOrder, InfoSetOrder::kTraversalByPlayer }) {
+		CFRTree* order_tree = new CFRTree(game, root);
+		order_tree->ConstructTree(1, { .layout = TreeLayout::kDepthFirst, .info_set_order = info_set_order });
+		auto start = std::chrono::steady_clock::now();
+		order_tree->CFR(format_iterations);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		const char* order_name = info_set_order == InfoSetOrder::kBuildOrder ? "Build order info sets: "
+			: info_set_order == InfoSetOrder::kTraversalOrder ? "Traversal order info sets: " : "Per player info sets: ";
+		std::cout << order_name << 2.0 * format_iterations * order_tree->NumNodes() / elapsed.count() << " nodes/sec, "
+			<< order_tree->InfoSetTableSize() << " byte table\n";
+	}
+
+	//Compare CFR throughput and regret table size of packed, cache aligned and derived strategy info sets.
+	for (const InfoSetLayout info_set_layout :
+		{ InfoSetLayout::kPacked, InfoSetLayout::kCacheAligned, InfoSetLayout::kDerivedStrategy }) {
+		CFRTree* aligned_tree = new CFRTree(game, root);
+		aligned_tree->ConstructTree(1, { .layout = TreeLayout::kDepthFirst,
+			.info_set_order = InfoSetOrder::kTraversalOrder, .info_set_layout = info_set_layout });
+		auto start = std::chrono::steady_clock::now();
+		aligned_tree->CFR(format_iterations);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		const char* info_set_layout_name = info_set_layout == InfoSetLayout::kPacked ? "Packed info sets: "
+			: info_set_layout == InfoSetLayout::kCacheAligned ? "Cache aligned info sets: " : "Derived strategy info sets: ";
+		std::cout << info_set_layout_name
+			<< 2.0 * format_iterations * aligned_tree->NumNodes() / elapsed.count() << " nodes/sec, "
+			<< aligned_tree->InfoSetTableSize() << " byte table\n";
+	}
+
+	//Compare regret table size, CFR throughput and exploitability of each precision against float,
+	//with exploitability after growing numbers of iterations to show each precision converging.
+	for (const InfoSetPrecision info_set_precision :
+		{ InfoSetPrecision::kFloat32, InfoSetPrecision::kBFloat16, InfoSetPrecision::kFixed32 }) {
+		const char* precision_name = info_set_precision == InfoSetPrecision::kFloat32 ? "Float32 info sets: "
+			: info_set_precision == InfoSetPrecision::kBFloat16 ? "BFloat16 info sets: " : "Fixed32 info sets: ";
+		std::cout << precision_name;
+		for (const int precision_iterations : { format_iterations / 100, format_iterations / 10, format_iterations }) {
+			CFRTree* precision_tree = new CFRTree(game, root);
+			precision_tree->ConstructTree(1, { .layout = TreeLayout::kDepthFirst,
+				.info_set_order = InfoSetOrder::kTraversalOrder, .info_set_precision = info_set_precision });
+			auto start = std::chrono::steady_clock::now();
+			precision_tree->CFR(precision_iterations);
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << precision_tree->Exploitability() << " exploitability after " << precision_iterations << " iterations, ";
+			if (precision_iterations == format_iterations) {
+				std::cout << 2.0 * format_iterations * precision_tree->NumNodes() / elapsed.count() << " nodes/sec, "
+					<< precision_tree->InfoSetTableSize() << " byte table\n";
+			}
+		}
+	}
+
+	//Compare CFR throughput with the declared fan-out bounds of the game and without them.
+	{
+		CFRTree* bounded_tree = new CFRTree(game, root);
+		bounded_tree->ConstructTree(1, { .format = TreeFormat::kNodePools });
+		auto start = std::chrono::steady_clock::now();
+		bounded_tree->CFR(format_iterations);
+		std::chrono::duration<double> bounded_elapsed = std::chrono::steady_clock::now() - start;
+
+		using UnboundedTree = CfrTree<Action, Player, ChanceNode, UnboundedRockPaperScissors>;
+		UnboundedRockPaperScissors* unbounded_game = new UnboundedRockPaperScissors();
+		UnboundedTree* unbounded_tree = new UnboundedTree(unbounded_game, root);
+		unbounded_tree->ConstructTree(1, { .format = TreeFormat::kNodePools });
+		start = std::chrono::steady_clock::now();
+		unbounded_tree->CFR(format_iterations);
+		std::chrono::duration<double> unbounded_elapsed = std::chrono::steady_clock::now() - start;
+
+		std::cout << "Static fan-out: " << 2.0 * format_iterations * bounded_tree->NumNodes() / bounded_elapsed.count()
+			<< " nodes/sec, runtime fan-out: "
+			<< 2.0 * format_iterations * unbounded_tree->NumNodes() / unbounded_elapsed.count() << " nodes/sec\n";
+	}
+
+	//Compare CFR throughput of walks on an explicit stack of frames against recursive walks.
+	for (const bool iterative_walks : { true, false }) {
+		CFRTree* walk_tree = new CFRTree(game, root);
+		walk_tree->ConstructTree();
+		walk_tree->SetIterativeWalks(iterative_walks);
+		auto start = std::chrono::steady_clock::now();
+		walk_tree->CFR(format_iterations);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << ( iterative_walks ? "Iterative walks: " : "Recursive walks: " )
+			<< 2.0 * format_iterations * walk_tree->NumNodes() / elapsed.count() << " nodes/sec\n";
+	}
+
+	//Compare MCCFR throughput and exploitability of trees compiled with different policies.
+	auto benchmark_policy = [&]<typename PolicyTree>(const char* policy_name) {
+		PolicyTree* policy_tree = new PolicyTree(game, root);
+		policy_tree->ConstructTree();
+		auto start = std::chrono::steady_clock::now();
+		policy_tree->MCCFR(format_iterations);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << policy_name
+			<< format_iterations / elapsed.count() << " iterations/sec, "
+			<< policy_tree->Exploitability() << " exploitability\n";
+	};
+	benchmark_policy.operator()<CFRTree>("Default policy: ");
+	benchmark_policy.operator()<CfrTree<Action, Player, ChanceNode, Game,
+		CfrPolicy<CfrSampling::kFull>>>("Full chance policy: ");
+	benchmark_policy.operator()<CfrTree<Action, Player, ChanceNode, Game,
+		CfrPolicy<CfrSampling::kPerCall, CfrUpdateRule::kRegretMatchingPlus>>>("Regret matching plus policy: ");
+	benchmark_policy.operator()<CfrTree<Action, Player, ChanceNode, Game,
+		CfrPolicy<CfrSampling::kPerCall, CfrUpdateRule::kRegretMatching, double>>>("Double walk value policy: ");
+
+	//Compare the regret update kernels of each instruction set, one regret matching and
+	//accumulation per info set visit, over a table too large for the vector registers.
+	const int kernel_info_sets = 1024;
+	const int kernel_passes = 2000;
+	for (const int num_actions : { 3, 8, 16, 64 }) {
+		std::vector<float> cum_regret(kernel_info_sets * num_actions);
+		std::vector<float> cum_strategy(kernel_info_sets * num_actions, 0.0f);
+		std::vector<float> strategy(kernel_info_sets * num_actions);
+		std::vector<float> utilities(num_actions);
+		for (int i_action = 0; i_action < num_actions; i_action++) {
+			utilities[i_action] = static_cast<float>(i_action % 5) - 2.0f;
+		}
+		for (const CfrKernels::InstructionSet instruction_set :
+			{ CfrKernels::InstructionSet::kScalar, CfrKernels::InstructionSet::kSse2, CfrKernels::InstructionSet::kAvx2 }) {
+			if (CfrKernels::Select(instruction_set) != instruction_set) {
+				continue;
+			}
+			for (int i_regret = 0; i_regret < kernel_info_sets * num_actions; i_regret++) {
+				cum_regret[i_regret] = static_cast<float>(i_regret % 7) - 3.0f;
+			}
+			auto start = std::chrono::steady_clock::now();
+			for (int i_pass = 0; i_pass < kernel_passes; i_pass++) {
+				for (int i_info_set = 0; i_info_set < kernel_info_sets; i_info_set++) {
+					const int offset = i_info_set * num_actions;
+					CfrKernels::AccumulateRegrets(&cum_regret[offset], utilities.data(), 0.5f, 1.0e-3f, num_actions);
+					CfrKernels::AccumulateStrategy(&cum_strategy[offset], &strategy[offset], 1.0e-3f, num_actions);
+					CfrKernels::RegretMatching(&cum_regret[offset], &strategy[offset], num_actions);
+				}
+			}
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << CfrKernels::Name(instruction_set) << " kernels, " << num_actions << " actions: "
+				<< 1.0e9 * elapsed.count() / ( static_cast<double>(kernel_passes) * kernel_info_sets ) << " ns/update\n";
+		}
+	}
+	CfrKernels::Select(CfrKernels::Supported());
+
+	return test_failures == 0 ? 0 : 1;
 }
 
@@ -130,5 +130,9 @@ public:
 
 	ChanceNode chance_node_{};
 
+	//Each player picks one of three actions, and the root chance node has a single child.
+	static constexpr int kMaxActions = 3;
+	static constexpr int kMaxChanceChildren = 1;
+
 	RockPaperScissors() = default;
 };
\ No newline at end of file
@@ -0,0 +1,865 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cfr.h"
+#include "cfr_kernels.h"
+#include "kuhn_poker.h"
+#include "nodes.h"
+#include "rock_paper_scissors.h"
+
+
+/**
+ * @brief Game whose chance node deals two player nodes that share an info set hash,
+ *		  but not their number of actions, as a collision of info set hashes would.
+ */
+class MismatchedInfoSetGame {
+public:
+
+	class Action;
+	class Player;
+	class ChanceNode;
+
+	using Node = ClientNode<Action, Player, ChanceNode>;
+
+	class Action {
+	public:
+		char action_ = 'n';
+		Action() = default;
+		explicit Action(char in_action) : action_{ in_action } {}
+		std::string ToHash() const { return std::string(1, action_); }
+	};
+
+	class Player {
+	public:
+		int num_actions_ = 2;
+		Player() = default;
+		explicit Player(int num_actions) : num_actions_{ num_actions } {}
+		bool IsPlayerOne() const { return true; }
+		std::string ToHash() const { return "Deal" + std::to_string(num_actions_); }
+		std::string ToInfoSetHash() const { return "Hidden"; }
+		Node Child(const Action a, const MismatchedInfoSetGame*) const { return Node{ a }; }
+		std::vector<Action> ActionList(const MismatchedInfoSetGame*) const {
+			std::vector<Action> actions;
+			for (int i_action = 0; i_action < num_actions_; i_action++) {
+				actions.push_back(Action{ static_cast<char>('a' + i_action) });
+			}
+			return actions;
+		}
+	};
+
+	class ChanceNode {
+	public:
+		std::string ToHash() const { return "Root"; }
+		std::vector<Node> Children(const MismatchedInfoSetGame*) const {
+			return { Node{ Player{ 2 }, 0.5f }, Node{ Player{ 3 }, 0.5f } };
+		}
+	};
+
+	using HistoryNode = TreeNode<Action, Player, ChanceNode>;
+
+	float UtilityFunc(std::vector<HistoryNode>) const { return 0.0f; }
+
+	ChanceNode chance_node_{};
+};
+
+
+/**
+ * @brief Rock paper scissors with actions 0, 1 and 2, whose terminal key is the outcome
+ *		  class of the two actions. Class 0 has key 0 and class 1 the key that the tree's
+ *		  key mixer maps to 1, so the 9 terminals share 3 keys that must stay distinct.
+ */
+class RepeatedKeyGame {
+public:
+
+	class Action;
+	class Player;
+	class ChanceNode;
+
+	using Node = ClientNode<Action, Player, ChanceNode>;
+
+	class Action {
+	public:
+		int action_ = 0;
+		Action() = default;
+		explicit Action(int in_action) : action_{ in_action } {}
+		std::string ToHash() const { return std::to_string(action_); }
+	};
+
+	class Player {
+	public:
+		bool player_one_ = true;
+		Player() = default;
+		explicit Player(bool player_one) : player_one_{ player_one } {}
+		bool IsPlayerOne() const { return player_one_; }
+		std::string ToHash() const { return player_one_ ? "One" : "Two"; }
+		std::string ToInfoSetHash() const { return player_one_ ? "One" : "Two"; }
+		Node Child(const Action a, const RepeatedKeyGame*) const {
+			return player_one_ ? Node{ Player{ false }, a } : Node{ a };
+		}
+		std::vector<Action> ActionList(const RepeatedKeyGame*) const {
+			return { Action{ 0 }, Action{ 1 }, Action{ 2 } };
+		}
+	};
+
+	class ChanceNode {
+	public:
+		std::string ToHash() const { return "Root"; }
+		std::vector<Node> Children(const RepeatedKeyGame*) const {
+			return { Node{ Player{ true }, 1.0f } };
+		}
+	};
+
+	using HistoryNode = TreeNode<Action, Player, ChanceNode>;
+
+	static constexpr float kClassUtilities[3] = { 0.0f, 1.0f, -1.0f };
+
+	/**
+	 * @brief Inverse of the splitmix64 finalizer the tree mixes terminal keys with.
+	 */
+	static std::uint64_t UnmixKey(std::uint64_t key) {
+		key = UnshiftXor(key, 31) * InverseOdd(0x94d049bb133111ebULL);
+		key = UnshiftXor(key, 27) * InverseOdd(0xbf58476d1ce4e5b9ULL);
+		return UnshiftXor(key, 30);
+	}
+
+	template<typename History>
+	static int OutcomeClass(const History& history) {
+		int actions[2] = { 0, 0 };
+		for (const auto& entry : history) {
+			if (entry.IsPlayerNode()) {
+				actions[entry.GetPlayerNode().IsPlayerOne() ? 0 : 1] = entry.GetAction().action_;
+			}
+		}
+		return ( actions[0] - actions[1] + 3 ) % 3;
+	}
+
+	float UtilityFunc(std::vector<HistoryNode> history) const {
+		return kClassUtilities[OutcomeClass(history)];
+	}
+
+	std::uint64_t TerminalKey(const HistoryView<Action, Player, ChanceNode>& history) const {
+		const int outcome_class = OutcomeClass(history);
+		return outcome_class == 0 ? 0 : outcome_class == 1 ? UnmixKey(1) : 2;
+	}
+
+	ChanceNode chance_node_{};
+
+private:
+
+	static std::uint64_t InverseOdd(std::uint64_t odd) {
+		//Each Newton step doubles the number of correct low bits.
+		std::uint64_t inverse = odd;
+		for (int i_step = 0; i_step < 5; i_step++) {
+			inverse *= 2 - odd * inverse;
+		}
+		return inverse;
+	}
+
+	static std::uint64_t UnshiftXor(std::uint64_t key, int shift) {
+		std::uint64_t result = key;
+		for (int i_step = 0; i_step * shift < 64; i_step++) {
+			result = key ^ ( result >> shift );
+		}
+		return result;
+	}
+};
+
+
+/**
+ * @brief Game of large fan-outs: the root chance node deals one of 1326 hands, as many
+ *		  as two hole cards from a deck, and player one then picks one of 300 actions,
+ *		  winning 1 for the action matching their hand and nothing otherwise.
+ */
+class WideGame {
+public:
+
+	static constexpr int kNumDeals = 1326;
+	static constexpr int kNumActions = 300;
+
+	class Action;
+	class Player;
+	class ChanceNode;
+
+	using Node = ClientNode<Action, Player, ChanceNode>;
+
+	class Action {
+	public:
+		int action_ = 0;
+		Action() = default;
+		explicit Action(int in_action) : action_{ in_action } {}
+		std::string ToHash() const { return std::to_string(action_); }
+	};
+
+	class Player {
+	public:
+		int deal_ = 0;
+		Player() = default;
+		explicit Player(int deal) : deal_{ deal } {}
+		bool IsPlayerOne() const { return true; }
+		std::string ToHash() const { return std::to_string(deal_); }
+		std::string ToInfoSetHash() const { return std::to_string(deal_); }
+		Node Child(const Action a, const WideGame*) const { return Node{ a }; }
+		std::vector<Action> ActionList(const WideGame*) const {
+			std::vector<Action> actions;
+			for (int i_action = 0; i_action < kNumActions; i_action++) {
+				actions.push_back(Action{ i_action });
+			}
+			return actions;
+		}
+	};
+
+	class ChanceNode {
+	public:
+		std::string ToHash() const { return "Deal"; }
+		std::vector<Node> Children(const WideGame*) const {
+			std::vector<Node> deals;
+			for (int deal = 0; deal < kNumDeals; deal++) {
+				deals.push_back(Node{ Player{ deal }, 1.0f / kNumDeals });
+			}
+			return deals;
+		}
+	};
+
+	using HistoryNode = TreeNode<Action, Player, ChanceNode>;
+
+	float UtilityFunc(std::vector<HistoryNode> history) const {
+		const HistoryNode& player_node = history[history.size() - 2];
+		return player_node.GetAction().action_ == player_node.GetPlayerNode().deal_ % kNumActions ? 1.0f : 0.0f;
+	}
+
+	ChanceNode chance_node_{};
+};
+
+
+/**
+ * @brief Rock paper scissors declaring fewer actions than its player nodes have.
+ */
+class UnderboundActionsGame : public RockPaperScissors {
+public:
+	static constexpr int kMaxActions = 2;
+};
+
+
+/**
+ * @brief Kuhn poker declaring fewer chance children than its deals.
+ */
+class UnderboundChanceGame : public KuhnPoker {
+public:
+	static constexpr int kMaxChanceChildren = 5;
+};
+
+
+/**
+ * @brief Kuhn poker keying each terminal by its betting and which card is higher, all
+ *		  its utility depends on, so the 30 terminals share 10 keys. Split between enough
+ *		  threads, its build leaves the terminals that end after two moves above the split depth.
+ */
+class KeyedKuhnPoker : public KuhnPoker {
+public:
+	std::uint64_t TerminalKey(const HistoryView<Action, Player, ChanceNode>& history) const {
+		Player last_player;
+		char last_action = 'n';
+		for (const auto& entry : history) {
+			if (entry.IsPlayerNode()) {
+				last_player = entry.GetPlayerNode();
+				last_action = entry.GetAction().action_;
+			}
+		}
+		const std::string betting = last_player.history_ + last_action;
+		return 2 * std::hash<std::string>{}( betting ) + ( last_player.card_one_ > last_player.card_two_ ? 1 : 0 );
+	}
+};
+
+
+/**
+ * @brief Game of a single deep line of play. Players take turns to continue or stop,
+ *		  and every 50 plies a chance node picks whether play goes on or ends after one
+ *		  last move, until the depth of the game is reached. Deep enough to test the
+ *		  walks on an explicit stack.
+ */
+class DeepChainGame {
+public:
+
+	static constexpr int kChanceInterval = 50;
+
+	class Action;
+	class Player;
+	class ChanceNode;
+
+	using Node = ClientNode<Action, Player, ChanceNode>;
+
+	class Action {
+	public:
+		char action_ = 'n';
+		Action() = default;
+		explicit Action(char in_action) : action_{ in_action } {}
+		std::string ToHash() const { return std::string(1, action_); }
+	};
+
+	class Player {
+	public:
+		int ply_ = 0;
+		int branch_ = 0;
+		Player() = default;
+		Player(int ply, int branch) : ply_{ ply }, branch_{ branch } {}
+		bool IsPlayerOne() const { return ply_ % 2 == 0; }
+		std::string ToHash() const { return std::to_string(ply_); }
+		std::string ToInfoSetHash() const { return std::to_string(ply_) + "/" + std::to_string(branch_); }
+		Node Child(const Action a, const DeepChainGame* game) const {
+			const int next_ply = ply_ + 1;
+			if (a.action_ == 's' || branch_ == 1 || next_ply >= game->depth_) {
+				return Node{ a };
+			}
+			if (next_ply % kChanceInterval == 0) {
+				return Node{ ChanceNode{ next_ply }, a };
+			}
+			return Node{ Player{ next_ply, 0 }, a };
+		}
+		std::vector<Action> ActionList(const DeepChainGame*) const {
+			return { Action{ 'c' }, Action{ 's' } };
+		}
+	};
+
+	class ChanceNode {
+	public:
+		int ply_ = 0;
+		ChanceNode() = default;
+		explicit ChanceNode(int ply) : ply_{ ply } {}
+		std::string ToHash() const { return "Chance" + std::to_string(ply_); }
+		std::vector<Node> Children(const DeepChainGame*) const {
+			return { Node{ Player{ ply_, 0 }, 0.3f }, Node{ Player{ ply_, 1 }, 0.7f } };
+		}
+	};
+
+	float UtilityFunc(HistoryView<Action, Player, ChanceNode> history) const {
+		const int length = static_cast<int>(history.size());
+		return ( length % 3 == 0 ? 1.0f : -0.5f ) * ( length % 2 == 0 ? -1.0f : 1.0f );
+	}
+
+	int depth_ = 2000;
+	ChanceNode chance_node_{};
+};
+
+
+/**
+ * @brief Game whose winning move only pays off by a rare chance outcome. Player one takes
+ *		  or passes a chance node that pays 1 with probability kWinProb and 0 otherwise,
+ *		  while passing pays 0. Player two has a single action after the chance node. Every
+ *		  regret update of player one is below the resolution of a kFixed32 info set.
+ */
+class RareChanceGame {
+public:
+
+	static constexpr float kWinProb = 1e-4f;
+
+	class Action;
+	class Player;
+	class ChanceNode;
+
+	using Node = ClientNode<Action, Player, ChanceNode>;
+
+	class Action {
+	public:
+		char action_ = 'n';
+		Action() = default;
+		explicit Action(char in_action) : action_{ in_action } {}
+		std::string ToHash() const { return std::string(1, action_); }
+	};
+
+	class Player {
+	public:
+		//0 for player one, 1 for player two after a win, 2 after a loss.
+		int role_ = 0;
+		Player() = default;
+		explicit Player(int role) : role_{ role } {}
+		bool IsPlayerOne() const { return role_ == 0; }
+		std::string ToHash() const { return std::to_string(role_); }
+		std::string ToInfoSetHash() const { return std::to_string(role_); }
+		Node Child(const Action a, const RareChanceGame*) const {
+			return a.action_ == 't' ? Node{ ChanceNode{ false }, a } : Node{ a };
+		}
+		std::vector<Action> ActionList(const RareChanceGame*) const {
+			if (role_ == 0) {
+				return { Action{ 't' }, Action{ 'p' } };
+			}
+			return { Action{ 'c' } };
+		}
+	};
+
+	class ChanceNode {
+	public:
+		bool root_ = true;
+		ChanceNode() = default;
+		explicit ChanceNode(bool root) : root_{ root } {}
+		std::string ToHash() const { return root_ ? "Root" : "Draw"; }
+		std::vector<Node> Children(const RareChanceGame*) const {
+			if (root_) {
+				return { Node{ Player{ 0 }, 1.0f } };
+			}
+			return { Node{ Player{ 1 }, kWinProb }, Node{ Player{ 2 }, 1.0f - kWinProb } };
+		}
+	};
+
+	using HistoryNode = TreeNode<Action, Player, ChanceNode>;
+
+	float UtilityFunc(std::vector<HistoryNode> history) const {
+		const HistoryNode& player_node = history[history.size() - 2];
+		return player_node.GetPlayerNode().role_ == 1 ? 1.0f : 0.0f;
+	}
+
+	ChanceNode chance_node_{};
+};
+
+
+/**
+ * @brief Checks of tree construction and the solvers on small games, run before the benchmarks.
+ */
+class TreeTests {
+public:
+
+	/**
+	 * @brief Runs every check, printing the outcome of each.
+	 * @return Number of failed checks.
+	 */
+	static int RunAll() {
+		int failures = 0;
+		failures += Check(MismatchedInfoSetsThrow(), "Mismatched info set action counts throw") ? 0 : 1;
+		failures += Check(HashIndexKeepsZeroKey(), "Hash index keeps key 0 distinct") ? 0 : 1;
+		failures += Check(VectorKernelsMatchScalar(), "Vector kernels match the scalar kernels") ? 0 : 1;
+		failures += Check(TerminalMemoRepeatedKeys(), "Terminal memo hits on repeated keys") ? 0 : 1;
+		failures += Check(TopLevelTerminalsMemoized(), "Terminals above the split depth go through the memo") ? 0 : 1;
+		failures += Check(OversizedChildrenOffsetThrows(), "Children offsets beyond 32 bits throw") ? 0 : 1;
+		failures += Check(OversizedNodePoolsThrow(), "Node pool indices and child starts beyond their bits throw") ? 0 : 1;
+		failures += Check(KuhnTreeSize(), "Kuhn poker search tree size") ? 0 : 1;
+		failures += Check(FanOutsBeyondBoundsThrow(), "Fan-outs beyond the declared bounds throw") ? 0 : 1;
+		failures += Check(WideFanOutsSolve(), "Large fan-outs build and solve") ? 0 : 1;
+		failures += Check(KuhnUniformExploitability(), "Kuhn poker uniform strategy exploitability") ? 0 : 1;
+		failures += Check(KuhnWalksConverge(), "Every walk converges on Kuhn poker") ? 0 : 1;
+		failures += Check(LevelSynchronousMatchesPerPassCfr(), "Level synchronous CFR matches CFR matching per pass") ? 0 : 1;
+		failures += Check(Fixed32RareChanceConverges(), "Fixed32 info sets learn from updates below their resolution") ? 0 : 1;
+		failures += Check(DerivedStrategiesMatchStored(), "Derived strategy info sets solve as stored ones do") ? 0 : 1;
+		failures += Check(AccuracySolvesStop(), "Solves to an unreachable accuracy stop at the bound") ? 0 : 1;
+		failures += Check(DeepChainWalksMatch(), "Iterative and recursive walks match on a deep chain") ? 0 : 1;
+		return failures;
+	}
+
+private:
+
+	static bool Check(bool passed, const char* name) {
+		std::cout << ( passed ? "Passed: " : "FAILED: " ) << name << "\n";
+		return passed;
+	}
+
+	/**
+	 * @return What tree.PrintTree() writes, captured rather than sent to std::cout.
+	 *		   Tests compare trees by their strategies and regrets this way.
+	 */
+	template<typename Tree>
+	static std::string PrintedTree(const Tree& tree) {
+		std::ostringstream printed;
+		//Puts std::cout's buffer back even if PrintTree throws.
+		struct CoutRestore {
+			std::streambuf* cout_buffer;
+			~CoutRestore() { std::cout.rdbuf(cout_buffer); }
+		} restore{ std::cout.rdbuf(printed.rdbuf()) };
+		tree.PrintTree();
+		return printed.str();
+	}
+
+	/**
+	 * @return Whether every vector instruction set the processor supports gives the
+	 *		   scalar kernels' results on random info sets of 4 to 16 actions: the same
+	 *		   bits for the accumulation kernels, and probabilities within
+	 *		   RegretMatchingTolerance for regret matching. Some regrets are zero or
+	 *		   negative, and some info sets have no positive regret.
+	 */
+	static bool VectorKernelsMatchScalar() {
+		using InstructionSet = CfrKernels::InstructionSet;
+		const InstructionSet selected = CfrKernels::Selected();
+		std::mt19937 rng{ 11 };
+		std::uniform_real_distribution<float> value_distribution{ -1.0f, 1.0f };
+		std::uniform_int_distribution<int> actions_distribution{ CfrKernels::kMinVectorActions, 16 };
+		bool matches = true;
+		for (const InstructionSet instruction_set : { InstructionSet::kSse2, InstructionSet::kAvx2 }) {
+			if (CfrKernels::Select(instruction_set) != instruction_set) {
+				continue;
+			}
+			for (int i_trial = 0; i_trial < 10000 && matches; i_trial++) {
+				const int num_actions = actions_distribution(rng);
+				std::vector<float> regrets(num_actions), utilities(num_actions);
+				for (int i_action = 0; i_action < num_actions; i_action++) {
+					regrets[i_action] = i_trial % 10 == 0 ? -std::abs(value_distribution(rng))
+						: i_action % 5 == 0 ? 0.0f : value_distribution(rng);
+					utilities[i_action] = value_distribution(rng);
+				}
+				std::vector<float> vector_strategy(num_actions), scalar_strategy(num_actions);
+				CfrKernels::RegretMatching(regrets.data(), vector_strategy.data(), num_actions);
+				CfrKernels::RegretMatchingScalar(regrets.data(), scalar_strategy.data(), num_actions);
+				for (int i_action = 0; i_action < num_actions; i_action++) {
+					const float tolerance = CfrKernels::RegretMatchingTolerance(num_actions)
+						* std::max(vector_strategy[i_action], scalar_strategy[i_action]);
+					matches = matches && std::abs(vector_strategy[i_action] - scalar_strategy[i_action]) <= tolerance;
+				}
+				const float val = value_distribution(rng);
+				const float weight = value_distribution(rng);
+				std::vector<float> vector_sums = regrets, scalar_sums = regrets;
+				CfrKernels::AccumulateRegrets(vector_sums.data(), utilities.data(), val, weight, num_actions);
+				CfrKernels::AccumulateRegretsScalar(scalar_sums.data(), utilities.data(), val, weight, num_actions);
+				matches = matches && vector_sums == scalar_sums;
+				vector_sums = regrets;
+				scalar_sums = regrets;
+				CfrKernels::AccumulateStrategy(vector_sums.data(), scalar_strategy.data(), weight, num_actions);
+				CfrKernels::AccumulateStrategyScalar(scalar_sums.data(), scalar_strategy.data(), weight, num_actions);
+				matches = matches && vector_sums == scalar_sums;
+			}
+		}
+		CfrKernels::Select(selected);
+		return matches;
+	}
+
+	/**
+	 * @return Whether ConstructTree throws for an info set whose nodes have different
+	 *		   action counts, with one thread and with the build split across threads.
+	 */
+	static bool MismatchedInfoSetsThrow() {
+		using MismatchedTree = CfrTree<MismatchedInfoSetGame::Action, MismatchedInfoSetGame::Player,
+			MismatchedInfoSetGame::ChanceNode, MismatchedInfoSetGame>;
+		MismatchedInfoSetGame game;
+		for (const int num_threads : { 1, 2 }) {
+			MismatchedTree tree{ &game, game.chance_node_ };
+			try {
+				tree.ConstructTree(num_threads);
+				return false;
+			}
+			catch (const std::runtime_error&) {
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @return Whether key 0, which marks empty buckets, is stored apart from key 1.
+	 */
+	static bool HashIndexKeepsZeroKey() {
+		InfoSetHashIndex index;
+		const bool zero_inserted = index.Insert(0, 0).second;
+		const bool one_inserted = index.Insert(1, 1).second;
+		const auto [zero_slot, zero_reinserted] = index.Insert(0, 5);
+		return zero_inserted && one_inserted && !zero_reinserted && zero_slot == 0 && index.Size() == 2;
+	}
+
+	/**
+	 * @return Whether the 9 terminals of RepeatedKeyGame reuse the utility of their
+	 *		   3 distinct keys exactly 6 times.
+	 */
+	static bool TerminalMemoRepeatedKeys() {
+		using RepeatedKeyTree = CfrTree<RepeatedKeyGame::Action, RepeatedKeyGame::Player,
+			RepeatedKeyGame::ChanceNode, RepeatedKeyGame>;
+		RepeatedKeyGame game;
+		RepeatedKeyTree tree{ &game, game.chance_node_ };
+		tree.ConstructTree(1);
+		return tree.TerminalMemoLookups() == 9 && tree.TerminalMemoHits() == 6;
+	}
+
+	/**
+	 * @return Whether every terminal of KeyedKuhnPoker is looked up in the terminal memo,
+	 *		   with one thread and with the build split so that some terminals sit above
+	 *		   the split depth, and CFR then prints the same tree from both builds.
+	 */
+	static bool TopLevelTerminalsMemoized() {
+		using KeyedTree = CfrTree<KuhnPoker::Action, KuhnPoker::Player, KuhnPoker::ChanceNode, KeyedKuhnPoker>;
+		KeyedKuhnPoker game;
+		std::vector<std::string> printed_trees;
+		for (const int num_threads : { 1, 4 }) {
+			KeyedTree tree{ &game, game.chance_node_ };
+			tree.ConstructTree(num_threads);
+			if (tree.TerminalMemoLookups() != 30) {
+				return false;
+			}
+			tree.CFR(100);
+			printed_trees.push_back(PrintedTree(tree));
+		}
+		return printed_trees[0] == printed_trees[1];
+	}
+
+	/**
+	 * @return Whether children offsets that do not fit in their 32 bits are rejected.
+	 */
+	static bool OversizedChildrenOffsetThrows() {
+		if (TreeUtils::CheckedChildrenOffset(0xFFFFFFFFLL) != 0xFFFFFFFFu) {
+			return false;
+		}
+		try {
+			TreeUtils::CheckedChildrenOffset(0x100000000LL);
+			return false;
+		}
+		catch (const std::length_error&) {
+			return true;
+		}
+	}
+
+	/**
+	 * @return Whether node pool references hold indices of up to kIndexBits, and child
+	 *		   starts up to 32 bits, and throw std::length_error beyond them.
+	 */
+	static bool OversizedNodePoolsThrow() {
+		const long long max_index = ( 1LL << NodePools::kIndexBits ) - 1;
+		const NodePools::NodeRef max_ref = NodePools::CheckedNodeRef(NodePools::kTerminal, max_index);
+		if (NodePools::Type(max_ref) != NodePools::kTerminal || NodePools::Index(max_ref) != max_index) {
+			return false;
+		}
+		if (NodePools::CheckedChildStart(0xFFFFFFFFull) != 0xFFFFFFFFu) {
+			return false;
+		}
+		try {
+			NodePools::CheckedNodeRef(NodePools::kPlayer, max_index + 1);
+			return false;
+		}
+		catch (const std::length_error&) {
+		}
+		try {
+			NodePools::CheckedChildStart(0x100000000ull);
+			return false;
+		}
+		catch (const std::length_error&) {
+			return true;
+		}
+	}
+
+	/**
+	 * @return Whether Kuhn poker builds its 55 nodes into a 656 byte search tree.
+	 */
+	static bool KuhnTreeSize() {
+		using KuhnTree = CfrTree<KuhnPoker::Action, KuhnPoker::Player, KuhnPoker::ChanceNode, KuhnPoker>;
+		KuhnPoker game;
+		KuhnTree tree{ &game, game.chance_node_ };
+		tree.ConstructTree();
+		return tree.NumNodes() == 55 && tree.SearchTreeSize() == 656;
+	}
+
+	/**
+	 * @return Whether the uniform strategy Kuhn poker starts from is 0.4583 exploitable:
+	 *		   each player gains 0.4583 on average by best responding to it.
+	 */
+	static bool KuhnUniformExploitability() {
+		using KuhnTree = CfrTree<KuhnPoker::Action, KuhnPoker::Player, KuhnPoker::ChanceNode, KuhnPoker>;
+		KuhnPoker game;
+		KuhnTree tree{ &game, game.chance_node_ };
+		tree.ConstructTree();
+		return std::abs(tree.Exploitability() - 0.4583f) < 1e-3f;
+	}
+
+	/**
+	 * @return Whether the average strategy of every walk of the tree, and of each info set
+	 *		   precision, approaches a Nash equilibrium of Kuhn poker.
+	 */
+	static bool KuhnWalksConverge() {
+		using KuhnTree = CfrTree<KuhnPoker::Action, KuhnPoker::Player, KuhnPoker::ChanceNode, KuhnPoker>;
+		const int iterations = 2000;
+		const float accuracy = 0.01f;
+		KuhnPoker game;
+		auto exploitability = [&](auto&& solve, const TreeOptions& options = {}) {
+			KuhnTree tree{ &game, game.chance_node_ };
+			tree.ConstructTree(1, options);
+			solve(tree);
+			return tree.Exploitability();
+		};
+		const float walk_exploitabilities[] = {
+			exploitability([&](KuhnTree& tree) { tree.CFR(iterations); }),
+			exploitability([&](KuhnTree& tree) { tree.SetIterativeWalks(true); tree.CFR(iterations); }),
+			exploitability([&](KuhnTree& tree) { tree.CFR(iterations); }, { .format = TreeFormat::kNodePools }),
+			exploitability([&](KuhnTree& tree) { tree.SetIterativeWalks(true); tree.CFR(iterations); }, { .format = TreeFormat::kNodePools }),
+			exploitability([&](KuhnTree& tree) { tree.MCCFR(50 * iterations); }),
+			exploitability([&](KuhnTree& tree) { tree.MCCFR_Parallel(50 * iterations, 2); }),
+			exploitability([&](KuhnTree& tree) { tree.CFR_LevelSynchronous(iterations, 2); }),
+			exploitability([&](KuhnTree& tree) { tree.CFR_TaskParallel(iterations, 2, 8); }),
+			exploitability([&](KuhnTree& tree) { tree.MCCFR_ToAccuracy(accuracy); }),
+			exploitability([&](KuhnTree& tree) { tree.MCCFR_ToAccuracy(accuracy, 2); }),
+			exploitability([&](KuhnTree& tree) { tree.CFR(iterations); }, { .info_set_precision = InfoSetPrecision::kBFloat16 }),
+			exploitability([&](KuhnTree& tree) { tree.CFR(iterations); }, { .info_set_precision = InfoSetPrecision::kFixed32 }),
+		};
+		for (const float walk_exploitability : walk_exploitabilities) {
+			//MCCFR_ToAccuracy stops at the first check within the accuracy.
+			if (!( walk_exploitability <= accuracy )) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @return Whether CFR_LevelSynchronous, which updates all of a player's info sets
+	 *		   at once, computes the same iterations on Kuhn poker as CFR regret matching
+	 *		   each info set once per pass, the same update schedule. Trees are compared
+	 *		   by the strategies and regrets PrintTree() writes.
+	 */
+	static bool LevelSynchronousMatchesPerPassCfr() {
+		using PerPassPolicy = CfrPolicy<CfrSampling::kPerCall, CfrUpdateRule::kRegretMatching, float, CfrMatchTiming::kPerPass>;
+		using KuhnTree = CfrTree<KuhnPoker::Action, KuhnPoker::Player, KuhnPoker::ChanceNode, KuhnPoker, PerPassPolicy>;
+		const int iterations = 200;
+		KuhnPoker game;
+		auto printed_tree = [&](auto&& solve) {
+			KuhnTree tree{ &game, game.chance_node_ };
+			tree.ConstructTree();
+			solve(tree);
+			return PrintedTree(tree);
+		};
+		return printed_tree([&](KuhnTree& tree) { tree.CFR(iterations); })
+			== printed_tree([&](KuhnTree& tree) { tree.CFR_LevelSynchronous(iterations, 2); });
+	}
+
+	/**
+	 * @return Whether CFR takes the winning move of RareChanceGame on kFixed32 info sets,
+	 *		   leaving its average strategy at most a tenth of the win away from the best
+	 *		   response, as it does on float info sets.
+	 */
+	static bool Fixed32RareChanceConverges() {
+		using RareChanceTree = CfrTree<RareChanceGame::Action, RareChanceGame::Player,
+			RareChanceGame::ChanceNode, RareChanceGame>;
+		RareChanceGame game;
+		for (const InfoSetPrecision info_set_precision : { InfoSetPrecision::kFloat32, InfoSetPrecision::kFixed32 }) {
+			RareChanceTree tree{ &game, game.chance_node_ };
+			tree.ConstructTree(1, { .info_set_precision = info_set_precision });
+			tree.CFR(1000);
+			if (!( tree.Exploitability() < 0.1f * RareChanceGame::kWinProb )) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @return Whether CFR_ToAccuracy and both MCCFR_ToAccuracy overloads run exactly
+	 *		   MaxAccuracyIterations() and return, when the accuracy asked for is out of reach.
+	 */
+	static bool AccuracySolvesStop() {
+		using KuhnTree = CfrTree<KuhnPoker::Action, KuhnPoker::Player, KuhnPoker::ChanceNode, KuhnPoker>;
+		KuhnPoker game;
+		KuhnTree tree{ &game, game.chance_node_ };
+		tree.ConstructTree(1);
+		tree.SetMaxAccuracyIterations(100);
+		tree.CFR_ToAccuracy(-1.0f);
+		bool stopped = tree.AccuracyIterations() == 100;
+		tree.MCCFR_ToAccuracy(-1.0f);
+		stopped = stopped && tree.AccuracyIterations() == 100;
+		tree.MCCFR_ToAccuracy(-1.0f, 2);
+		stopped = stopped && tree.AccuracyIterations() == 100;
+		return stopped && tree.Exploitability() < 0.1f;
+	}
+
+	/**
+	 * @return Whether Kuhn poker solved by MCCFR on kDerivedStrategy info sets prints
+	 *		   the same tree as on kPacked ones, current strategies included, after a
+	 *		   solve and after a second solve continuing from the average strategy.
+	 */
+	static bool DerivedStrategiesMatchStored() {
+		using KuhnTree = CfrTree<KuhnPoker::Action, KuhnPoker::Player, KuhnPoker::ChanceNode, KuhnPoker>;
+		KuhnPoker game;
+		auto printed_trees = [&](InfoSetLayout info_set_layout) {
+			KuhnTree tree{ &game, game.chance_node_ };
+			tree.ConstructTree(1, { .info_set_layout = info_set_layout });
+			std::string printed;
+			//Both solves sample chance nodes with std::rand, so each starts from the same seed.
+			std::srand(7);
+			for (int i_solve = 0; i_solve < 2; i_solve++) {
+				tree.MCCFR(500);
+				printed += PrintedTree(tree);
+			}
+			return printed;
+		};
+		return printed_trees(InfoSetLayout::kDerivedStrategy) == printed_trees(InfoSetLayout::kPacked);
+	}
+
+	/**
+	 * @return Whether ConstructTree throws for a player node with more actions than
+	 *		   kMaxActions and for a chance node with more children than kMaxChanceChildren,
+	 *		   with one thread and with the build split across threads.
+	 */
+	static bool FanOutsBeyondBoundsThrow() {
+		using ActionsTree = CfrTree<RockPaperScissors::Action, RockPaperScissors::Player,
+			RockPaperScissors::ChanceNode, UnderboundActionsGame>;
+		using ChanceTree = CfrTree<KuhnPoker::Action, KuhnPoker::Player, KuhnPoker::ChanceNode, UnderboundChanceGame>;
+		UnderboundActionsGame actions_game;
+		UnderboundChanceGame chance_game;
+		for (const int num_threads : { 1, 2 }) {
+			try {
+				ActionsTree actions_tree{ &actions_game, actions_game.chance_node_ };
+				actions_tree.ConstructTree(num_threads);
+				return false;
+			}
+			catch (const std::length_error&) {
+			}
+			try {
+				ChanceTree chance_tree{ &chance_game, chance_game.chance_node_ };
+				chance_tree.ConstructTree(num_threads);
+				return false;
+			}
+			catch (const std::length_error&) {
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @return Whether CFR and MCCFR give the same tree when walked on an explicit stack
+	 *		   as when walked recursively, on DeepChainGame, both on the search tree and
+	 *		   on node pools. Trees are compared by the strategies and regrets PrintTree() writes.
+	 */
+	static bool DeepChainWalksMatch() {
+		using ChainTree = CfrTree<DeepChainGame::Action, DeepChainGame::Player,
+			DeepChainGame::ChanceNode, DeepChainGame>;
+		DeepChainGame game;
+		auto printed_tree = [&](TreeFormat format, bool iterative_walks, bool with_sampling) {
+			ChainTree tree{ &game, game.chance_node_ };
+			tree.ConstructTree(1, { .format = format });
+			tree.SetIterativeWalks(iterative_walks);
+			//Both walks sample chance nodes with std::rand, so each starts from the same seed.
+			std::srand(7);
+			if (with_sampling) {
+				tree.MCCFR(200);
+			}
+			else {
+				tree.CFR(20);
+			}
+			return PrintedTree(tree);
+		};
+		for (const TreeFormat format : { TreeFormat::kByteRecords, TreeFormat::kNodePools }) {
+			for (const bool with_sampling : { false, true }) {
+				if (printed_tree(format, true, with_sampling) != printed_tree(format, false, with_sampling)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @return Whether WideGame builds every node, with one thread and split across
+	 *		   threads, and CFR then finds the winning action of nearly every hand.
+	 */
+	static bool WideFanOutsSolve() {
+		using WideTree = CfrTree<WideGame::Action, WideGame::Player, WideGame::ChanceNode, WideGame>;
+		const long long num_nodes = 1 + WideGame::kNumDeals + static_cast<long long>(WideGame::kNumDeals) * WideGame::kNumActions;
+		WideGame game;
+		for (const int num_threads : { 1, 2 }) {
+			WideTree tree{ &game, game.chance_node_ };
+			tree.ConstructTree(num_threads);
+			if (tree.NumNodes() != num_nodes) {
+				return false;
+			}
+			tree.CFR(50);
+			if (!( tree.Exploitability() < 0.05f )) {
+				return false;
+			}
+		}
+		return true;
+	}
+};